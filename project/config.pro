@@ -6,6 +6,12 @@
 
 CONFIG *= googleBenchmark
 
+# suspend overflow and underflow of finger tree middle trees
+#DEFINES *= FINGER_TREE_LAZY
+
+# search the keys of inner nodes with AVX2 instead of SSE2
+#QMAKE_CXXFLAGS += -mavx2
+
 OBJECTS_DIR = out/obj
 MOC_DIR = out/moc
 TARGET = out/main
@@ -35,11 +41,27 @@ HEADERS += src/collections/finger_tree/node/node.hpp
 
 HEADERS += src/collections/finger_tree/_prelude.hpp
 HEADERS += src/collections/finger_tree/core.hpp
+HEADERS += src/collections/finger_tree/measure.hpp
 HEADERS += src/collections/finger_tree/base.hpp
 HEADERS += src/collections/finger_tree/deep.hpp
 HEADERS += src/collections/finger_tree/single.hpp
 HEADERS += src/collections/finger_tree/empty.hpp
+HEADERS += src/collections/finger_tree/suspension.hpp
+HEADERS += src/collections/finger_tree/transient.hpp
+HEADERS += src/collections/finger_tree/iterator.hpp
+HEADERS += src/collections/finger_tree/concurrent.hpp
 
+HEADERS += src/utils/compare.hpp
+HEADERS += src/utils/epoch.hpp
+HEADERS += src/utils/key_search.hpp
+HEADERS += src/utils/local_shared_ptr.hpp
+HEADERS += src/utils/reclaimer.hpp
+HEADERS += src/utils/ref_count.hpp
+HEADERS += src/utils/scratch_arena.hpp
+HEADERS += src/utils/slab_pool.hpp
+HEADERS += src/utils/tagged_ptr.hpp
+HEADERS += src/utils/thread_policy.hpp
+HEADERS += src/utils/thread_pool.hpp
 HEADERS += src/utils/uninit_exception.hpp
 HEADERS += src/utils/variant_exception.hpp
 
@@ -6,6 +6,7 @@
 
 namespace benchmarks::b_tree {
   using BT = collections::b_tree::BTree<int, int, 32>;
+  using LBT = collections::b_tree::LocalBTree<int, int, 32>;
 
   auto get(benchmark::State& state) -> void {
     auto tree = BT();
@@ -39,4 +40,22 @@ namespace benchmarks::b_tree {
     benchmark::DoNotOptimize(tree);
     state.SetComplexityN(state.range(0));
   }
+
+  // See above, but on a thread local tree.
+  auto insert_local(benchmark::State& state) -> void {
+    auto tree = LBT();
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      tree = tree.insert(v, v);
+    }
+
+    for (auto _ : state) {
+      tree.insert(std::rand(), 0);
+      benchmark::DoNotOptimize(tree);
+      benchmark::ClobberMemory();
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
 }
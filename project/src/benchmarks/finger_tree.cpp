@@ -4,9 +4,12 @@
 
 #include <benchmark/benchmark.h>
 #include <cmath>
+#include <utility>
+#include <vector>
 
 namespace benchmarks::finger_tree {
   using FT = collections::finger_tree::FingerTree<int, int>;
+  using LFT = collections::finger_tree::LocalFingerTree<int, int>;
   using Dir = collections::finger_tree::Direction;
 
   // for a given depth d, this function returns the number of elements k
@@ -58,6 +61,271 @@ namespace benchmarks::finger_tree {
     state.SetComplexityN(tree.size());
   }
 
+  // Accessing random indices, this descends by the cached sizes in the same
+  // way get descends by the cached keys.
+  auto at(benchmark::State& state) -> void {
+    auto tree = FT();
+
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      tree.insert(v, v);
+    }
+
+    for (auto _ : state) {
+      auto v = tree.at(std::rand() % tree.size());
+      benchmark::DoNotOptimize(v);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(tree.size());
+  }
+
+  // Iterating over all key value pairs in key order, each step is O(1)
+  // amortized and does not allocate.
+  auto iterate(benchmark::State& state) -> void {
+    auto tree = FT();
+
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      tree.insert(v, v);
+    }
+
+    for (auto _ : state) {
+      auto sum = 0;
+      for (const auto& [key, val] : tree) {
+        sum += val;
+      }
+
+      benchmark::DoNotOptimize(sum);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(tree.size());
+  }
+
+  // Inserting random keys into a tree built from random keys gives a reliable
+  // average-case insert benchmark, each iteration inserts into a copy to
+  // measure the persistent insert.
+  auto insert(benchmark::State& state) -> void {
+    auto tree = FT();
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      tree.insert(v, v);
+    }
+
+    for (auto _ : state) {
+      auto copy = tree;
+      auto v = copy.insert(std::rand(), 0);
+      benchmark::DoNotOptimize(v);
+      benchmark::DoNotOptimize(copy);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // See above, but on a thread local tree, the difference is the cost of the
+  // atomic reference counts of the copied path.
+  auto insert_local(benchmark::State& state) -> void {
+    auto tree = LFT();
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      tree.insert(v, v);
+    }
+
+    for (auto _ : state) {
+      auto copy = tree;
+      auto v = copy.insert(std::rand(), 0);
+      benchmark::DoNotOptimize(v);
+      benchmark::DoNotOptimize(copy);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // See above, but inside a real time scope, nodes are only taken from the
+  // blocks reserved beforehand and never from the global allocator.
+  auto insert_realtime(benchmark::State& state) -> void {
+    auto tree = FT();
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      tree.insert(v, v);
+    }
+
+    // NOTE: the copies are dropped every iteration, their nodes go back to
+    // the same thread's cache
+    FT::reserve(256);
+    SlabPool::Realtime realtime;
+
+    for (auto _ : state) {
+      auto copy = tree;
+      auto v = copy.insert(std::rand(), 0);
+      benchmark::DoNotOptimize(v);
+      benchmark::DoNotOptimize(copy);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // See insert, but using the naive split and concat based insert.
+  auto insert_by_split(benchmark::State& state) -> void {
+    auto tree = FT();
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      tree.insert(v, v);
+    }
+
+    for (auto _ : state) {
+      auto copy = tree;
+      auto v = copy.insert_by_split(std::rand(), 0);
+      benchmark::DoNotOptimize(v);
+      benchmark::DoNotOptimize(copy);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // Inserting a batch of random keys through a transient of a shared tree,
+  // only the first insert on each path has to copy it, the others modify the
+  // transient's nodes in place.
+  auto insert_transient(benchmark::State& state) -> void {
+    auto tree = FT();
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      tree.insert(v, v);
+    }
+
+    for (auto _ : state) {
+      auto transient = tree.transient();
+      for (auto i = 0; i < 1024; i++) {
+        transient.insert(std::rand(), 0);
+      }
+
+      auto frozen = transient.freeze();
+      benchmark::DoNotOptimize(frozen);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // Inserting a batch of 4096 random key value pairs into a copy, the batch
+  // is sorted once and applied in key order.
+  auto insert_batch(benchmark::State& state) -> void {
+    auto tree = FT();
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      tree.insert(v, v);
+    }
+
+    std::vector<std::pair<int, int>> batch;
+    for (auto i = 0; i < 4096; i++) {
+      batch.emplace_back(std::rand(), i);
+    }
+
+    for (auto _ : state) {
+      auto copy = tree;
+      auto v = copy.insert_batch(batch);
+      benchmark::DoNotOptimize(v);
+      benchmark::DoNotOptimize(copy);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // Removing keys which are known to exist in the tree gives a reliable
+  // average-case remove benchmark, each iteration removes from a copy to
+  // measure the persistent remove.
+  auto remove(benchmark::State& state) -> void {
+    auto tree = FT();
+    std::vector<int> keys;
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      keys.push_back(v);
+      tree.insert(v, v);
+    }
+
+    uint i = 0;
+    for (auto _ : state) {
+      auto copy = tree;
+      auto v = copy.remove(keys[i++ % keys.size()]);
+      benchmark::DoNotOptimize(v);
+      benchmark::DoNotOptimize(copy);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // Merging a tree of random keys with a tree a 16th of its size, the
+  // smaller tree's keys decide where the larger one is split.
+  auto merge(benchmark::State& state) -> void {
+    auto left = FT();
+    auto right = FT();
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      left.insert(v, v);
+      if (i % 16 == 0) {
+        right.insert(std::rand(), v);
+      }
+    }
+
+    for (auto _ : state) {
+      auto merged = FT::merge(left, right);
+      benchmark::DoNotOptimize(merged);
+    }
+
+    benchmark::DoNotOptimize(left);
+    benchmark::DoNotOptimize(right);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // Erasing a window of 1024 contiguous keys from a copy, this splits twice
+  // and concatenates once regardless of the window size.
+  auto erase_range(benchmark::State& state) -> void {
+    auto tree = FT();
+    for (auto i = 0; i < state.range(0); i++) {
+      tree.push(Dir::Right, i, i);
+    }
+
+    for (auto _ : state) {
+      auto copy = tree;
+      auto lo = std::rand() % state.range(0);
+      auto v = copy.erase_range(lo, lo + 1024);
+      benchmark::DoNotOptimize(v);
+      benchmark::DoNotOptimize(copy);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // See above, but using the naive split and concat based remove.
+  auto remove_by_split(benchmark::State& state) -> void {
+    auto tree = FT();
+    std::vector<int> keys;
+    for (auto i = 0; i < state.range(0); i++) {
+      auto v = std::rand();
+      keys.push_back(v);
+      tree.insert(v, v);
+    }
+
+    uint i = 0;
+    for (auto _ : state) {
+      auto copy = tree;
+      auto v = copy.remove_by_split(keys[i++ % keys.size()]);
+      benchmark::DoNotOptimize(v);
+      benchmark::DoNotOptimize(copy);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
   // The worst-case performance of push is given by pushing onto a fully unsafe
   // side, i.e. every deep tree has four digits on that side.
   //
@@ -104,6 +372,111 @@ namespace benchmarks::finger_tree {
     state.SetComplexityN(tree.size());
   }
 
+  // Building a tree from sorted keys bottom up, compared to pushing each key
+  // one after another.
+  auto from_sorted(benchmark::State& state) -> void {
+    std::vector<std::pair<int, int>> pairs;
+    for (auto i = 0; i < state.range(0); i++) {
+      pairs.emplace_back(i, i);
+    }
+
+    for (auto _ : state) {
+      auto tree = FT::from_sorted(pairs);
+      benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetComplexityN(state.range(0));
+  }
+
+  // See above, but pushing each key.
+  auto from_pushes(benchmark::State& state) -> void {
+    for (auto _ : state) {
+      auto tree = FT();
+      for (auto i = 0; i < state.range(0); i++) {
+        tree.push(Dir::Right, i, i);
+      }
+      benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetComplexityN(state.range(0));
+  }
+
+  // See from_sorted, but building chunks on the thread pool.
+  auto from_sorted_parallel(benchmark::State& state) -> void {
+    std::vector<std::pair<int, int>> pairs;
+    for (auto i = 0; i < state.range(0); i++) {
+      pairs.emplace_back(i, i);
+    }
+
+    for (auto _ : state) {
+      auto tree = FT::from_sorted_parallel(pairs);
+      benchmark::DoNotOptimize(tree);
+    }
+
+    state.SetComplexityN(state.range(0));
+  }
+
+  // Summing all values of a tree on the thread pool, the chunks are found by
+  // index and iterated without splitting the tree.
+  auto parallel_reduce(benchmark::State& state) -> void {
+    auto tree = FT();
+    for (auto i = 0; i < state.range(0); i++) {
+      tree.push(Dir::Right, i, i);
+    }
+
+    for (auto _ : state) {
+      auto sum = tree.parallel_reduce(
+        0l,
+        [](long acc, int const&, int const& val) { return acc + val; },
+        [](long left, long right) { return left + right; }
+      );
+      benchmark::DoNotOptimize(sum);
+    }
+
+    benchmark::DoNotOptimize(tree);
+    state.SetComplexityN(state.range(0));
+  }
+
+  // Dropping the last reference to a tree destroys all of its nodes on the
+  // dropping thread.
+  auto drop(benchmark::State& state) -> void {
+    std::vector<std::pair<int, int>> pairs;
+    for (auto i = 0; i < state.range(0); i++) {
+      pairs.emplace_back(i, i);
+    }
+
+    for (auto _ : state) {
+      state.PauseTiming();
+      auto tree = new FT(FT::from_sorted(pairs));
+      state.ResumeTiming();
+
+      delete tree;
+    }
+
+    state.SetComplexityN(state.range(0));
+  }
+
+  // See above, but handing the nodes to a background reclaimer, this only
+  // measures the dropping thread.
+  auto drop_deferred(benchmark::State& state) -> void {
+    std::vector<std::pair<int, int>> pairs;
+    for (auto i = 0; i < state.range(0); i++) {
+      pairs.emplace_back(i, i);
+    }
+
+    auto reclaimer = Reclaimer(true);
+    for (auto _ : state) {
+      state.PauseTiming();
+      auto tree = new FT(FT::from_sorted(pairs));
+      state.ResumeTiming();
+
+      auto scope = Reclaimer::Scope(reclaimer);
+      delete tree;
+    }
+
+    state.SetComplexityN(state.range(0));
+  }
+
   // The worst-case performance of concat is dependent on the packing required
   // on the inside of the new tree.
   //
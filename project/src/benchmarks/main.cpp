@@ -29,11 +29,76 @@ BENCHMARK(benchmarks::b_tree::insert)
   ->Range(2 << 10, 2 << 18)
   ->Complexity(benchmark::oAuto);
 
+BENCHMARK(benchmarks::b_tree::insert_local)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
 BENCHMARK(benchmarks::finger_tree::get)
   ->RangeMultiplier(2)
   ->Range(2 << 10, 2 << 18)
   ->Complexity(benchmark::oAuto);
 
+BENCHMARK(benchmarks::finger_tree::at)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::iterate)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::insert)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::insert_local)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::insert_realtime)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::insert_by_split)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::insert_transient)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::insert_batch)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::remove)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::remove_by_split)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::merge)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::erase_range)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
 // NOTE: values required to provoke the worst case
 BENCHMARK(benchmarks::finger_tree::push_worst)
   ->Arg(1820)
@@ -49,6 +114,36 @@ BENCHMARK(benchmarks::finger_tree::push_avg)
   ->Range(2 << 10, 2 << 18)
   ->Complexity(benchmark::oAuto);
 
+BENCHMARK(benchmarks::finger_tree::from_sorted)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::from_pushes)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::drop)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::drop_deferred)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::from_sorted_parallel)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
+BENCHMARK(benchmarks::finger_tree::parallel_reduce)
+  ->RangeMultiplier(2)
+  ->Range(2 << 10, 2 << 18)
+  ->Complexity(benchmark::oAuto);
+
 // NOTE: required for easy summation in thesis
 BENCHMARK(benchmarks::finger_tree::concat)
   ->Arg(1820)
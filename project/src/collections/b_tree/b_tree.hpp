@@ -7,85 +7,105 @@
 #include "src/collections/b_tree/node/core.hpp"
 
 namespace collections::b_tree {
-  template<typename K, typename V, uint N = ORDER_DEFAULT>
+  // the thread policy P decides whether the tree may be shared between
+  // threads, see src/utils/thread_policy.hpp, the keys are ordered by the
+  // comparator C, see src/utils/compare.hpp
+  template<
+    typename K,
+    typename V,
+    uint N = ORDER_DEFAULT,
+    typename P = thread_policy::Shared,
+    typename C = compare::ThreeWay<K>
+  >
   class BTree {
     public:
-      BTree(node::SharedNode<K, V, N>&& root);
-      BTree(node::Deep<K, V, N>&& root);
-      BTree(node::Leaf<K, V, N>&& root);
+      BTree(node::SharedNode<K, V, N, P, C>&& root);
+      BTree(node::Deep<K, V, N, P, C>&& root);
+      BTree(node::Leaf<K, V, N, P, C>&& root);
       BTree();
 
     public:
-      auto root() const -> const node::Node<K, V, N>& { return *this->_root; }
+      auto root() const -> const node::Node<K, V, N, P, C>& { return *this->_root; }
 
     public:
-      auto insert(const K& key, const V& val) const -> BTree<K, V, N>;
-      auto get(const K& key) const -> const V*;
+      auto insert(const K& key, const V& val) const -> BTree<K, V, N, P, C>;
+      auto get(const K& key) const -> const V* { return this->template get<K>(key); }
+
+      // like get, but for any key type the comparator is transparent for
+      template<compare::Lookup<K, C> Q>
+      auto get(const Q& key) const -> const V*;
+
       auto size() const -> uint;
       auto show() const -> void;
 
     private:
-      node::SharedNode<K, V, N> _root;
+      node::SharedNode<K, V, N, P, C> _root;
   };
 
-  template<typename K, typename V, uint N>
-  BTree<K, V, N>::BTree(node::SharedNode<K, V, N>&& root) : _root(root) {}
+  template<typename K, typename V, uint N, typename P, typename C>
+  BTree<K, V, N, P, C>::BTree(node::SharedNode<K, V, N, P, C>&& root) : _root(root) {}
 
-  template<typename K, typename V, uint N>
-  BTree<K, V, N>::BTree(
-    node::Leaf<K, V, N>&& root
-  ) : BTree(std::static_pointer_cast<node::Node<K, V, N>>(
-    std::make_shared<node::Leaf<K, V, N>>(std::move(root))
+  template<typename K, typename V, uint N, typename P, typename C>
+  BTree<K, V, N, P, C>::BTree(
+    node::Leaf<K, V, N, P, C>&& root
+  ) : BTree(node::SharedNode<K, V, N, P, C>(
+    P::template make_shared<node::Leaf<K, V, N, P, C>>(std::move(root))
   )) {}
 
-  template<typename K, typename V, uint N>
-  BTree<K, V, N>::BTree(
-    node::Deep<K, V, N>&& root
-  ) : BTree(std::static_pointer_cast<node::Node<K, V, N>>(
-    std::make_shared<node::Deep<K, V, N>>(std::move(root))
+  template<typename K, typename V, uint N, typename P, typename C>
+  BTree<K, V, N, P, C>::BTree(
+    node::Deep<K, V, N, P, C>&& root
+  ) : BTree(node::SharedNode<K, V, N, P, C>(
+    P::template make_shared<node::Deep<K, V, N, P, C>>(std::move(root))
   )) {}
 
-  template<typename K, typename V, uint N>
-  BTree<K, V, N>::BTree() : BTree(std::static_pointer_cast<node::Node<K, V, N>>(
-    std::make_shared<node::Leaf<K, V, N>>(node::Leaf<K, V, N>::empty_root())
+  template<typename K, typename V, uint N, typename P, typename C>
+  BTree<K, V, N, P, C>::BTree() : BTree(node::SharedNode<K, V, N, P, C>(
+    P::template make_shared<node::Leaf<K, V, N, P, C>>(node::Leaf<K, V, N, P, C>::empty_root())
   )) {}
 
-  template<typename K, typename V, uint N>
-  auto BTree<K, V, N>::insert(
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto BTree<K, V, N, P, C>::insert(
     const K& key,
     const V& val
-  ) const -> BTree<K, V, N> {
+  ) const -> BTree<K, V, N, P, C> {
     auto res = this->_root->insert(key, val);
 
     return std::visit([](auto&& res){
       using T = std::decay_t<decltype(res)>;
-      if constexpr (std::is_same_v<T, node::Inserted<K, V, N>>) {
+      if constexpr (std::is_same_v<T, node::Inserted<K, V, N, P, C>>) {
         return BTree(std::move(res));
-      } else if constexpr (std::is_same_v<T, node::Split<K, V, N>>) {
+      } else if constexpr (std::is_same_v<T, node::Split<K, V, N, P, C>>) {
         auto [left, right] = res;
-        return BTree(node::Deep<K, V, N>::from_children({
+        return BTree(node::Deep<K, V, N, P, C>::from_children({
           std::move(left),
           std::move(right)
         }));
       } else {
-        static_assert(false, "non-exhaustive visitor");
+        static_assert(sizeof(T) == 0, "non-exhaustive visitor");
       }
     }, res);
   }
 
-  template<typename K, typename V, uint N>
-  auto BTree<K, V, N>::get(const K& key) const -> const V* {
+  template<typename K, typename V, uint N, typename P, typename C>
+  template<compare::Lookup<K, C> Q>
+  auto BTree<K, V, N, P, C>::get(const Q& key) const -> const V* {
     return this->_root->get(key);
   }
 
-  template<typename K, typename V, uint N>
-  auto BTree<K, V, N>::size() const -> uint {
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto BTree<K, V, N, P, C>::size() const -> uint {
     return this->_root->size();
   }
 
 
-  template<typename K, typename V, uint N>
-  auto BTree<K, V, N>::show() const -> void {
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto BTree<K, V, N, P, C>::show() const -> void {
     node::show(*this->_root, 0);
   }
+
+  // a b-tree with non-atomic reference counts, which must never leave the
+  // thread it was created on
+  template<typename K, typename V, uint N = ORDER_DEFAULT, typename C = compare::ThreeWay<K>>
+  using LocalBTree = BTree<K, V, N, thread_policy::Local, C>;
 }
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "src/utils/compare.hpp"
+#include "src/utils/thread_policy.hpp"
+
 #include <sys/types.h>
 
 namespace collections::b_tree {
   constexpr uint ORDER_DEFAULT = 32;
 
-  template<typename K, typename V, uint N>
+  template<typename K, typename V, uint N, typename P, typename C>
   class BTree;
 }
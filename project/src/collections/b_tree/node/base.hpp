@@ -1,5 +1,7 @@
 #pragma once
 
+#include "src/utils/key_search.hpp"
+
 #include "src/collections/b_tree/node/core.hpp"
 
 #include <sys/types.h>
@@ -7,11 +9,12 @@
 #include <algorithm>
 #include <iterator>
 #include <span>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace collections::b_tree::node {
-  template<typename K, typename V, uint N>
+  template<typename K, typename V, uint N, typename P, typename C>
   class Node {
     public:
       static_assert(2 < N, "N must be greater than 2");
@@ -32,6 +35,8 @@ namespace collections::b_tree::node {
     public:
       using KeyType = K;
       using ValueType = V;
+      using PolicyType = P;
+      using CompareType = C;
 
     protected:
       Node(std::vector<K>&& keys, uint _size);
@@ -67,34 +72,70 @@ namespace collections::b_tree::node {
       virtual auto insert(
         const K& key,
         const V& val
-      ) const -> InsertResult<K, V, N> = 0;
+      ) const -> InsertResult<K, V, N, P, C> = 0;
 
-      virtual auto get(const K& key) const -> const V* = 0;
+      // return a pointer to the value this key refers to, or a nullptr if the
+      // key didn't exist, the key may be of any type the comparator is
+      // transparent for
+      template<typename Q>
+      auto get(const Q& key) const -> const V*;
 
     protected:
-      auto index(const K& key) const -> uint;
+      // return the index of the first key which is not less than the given
+      // key and whether it is equal to it
+      template<typename Q>
+      auto index(const Q& key) const -> std::pair<uint, bool>;
 
     protected:
       std::vector<K> _keys;
       uint _size;
   };
 
-  template<typename K, typename V, uint N>
-  Node<K, V, N>::Node(
+  template<typename K, typename V, uint N, typename P, typename C>
+  Node<K, V, N, P, C>::Node(
     std::vector<K>&& keys,
     uint size
   ) : _keys(std::move(keys)), _size(size) {}
 
-  template<typename K, typename V, uint N>
-  auto Node<K, V, N>::index(const K& key) const -> uint {
-    // TODO: linear scan for small factors
+  template<typename K, typename V, uint N, typename P, typename C>
+  template<typename Q>
+  auto Node<K, V, N, P, C>::get(const Q& key) const -> const V* {
+    if (this->is_leaf()) {
+      return static_cast<const Leaf<K, V, N, P, C>*>(this)->get(key);
+    } else {
+      return static_cast<const Deep<K, V, N, P, C>*>(this)->get(key);
+    }
+  }
 
-    auto begin = this->keys().begin();
-    auto end = this->keys().end();
+  template<typename K, typename V, uint N, typename P, typename C>
+  template<typename Q>
+  auto Node<K, V, N, P, C>::index(const Q& key) const -> std::pair<uint, bool> {
+    auto keys = this->keys();
+
+    // NOTE: a node has at most N keys, counting the smaller ones with vector
+    // compares beats a binary search for the usual orders
+    if constexpr (key_search::IS_VECTORIZED<K, C> && std::is_same_v<Q, K>) {
+      uint idx = key_search::lower_bound(keys.data(), keys.size(), key);
+      return std::pair(idx, idx < keys.size() && keys[idx] == key);
+    }
+
+    // NOTE: keys are unique, so the search can stop at an equal key
+    uint lo = 0;
+    uint hi = keys.size();
+    while (lo < hi) {
+      auto mid = lo + (hi - lo) / 2;
+      auto order = C()(keys[mid], key);
+      if (order == 0) {
+        return std::pair(mid, true);
+      }
 
-    auto range = std::equal_range(begin, end, key);
-    auto idx = std::distance(begin, range.first);
+      if (order < 0) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
 
-    return idx;
+    return std::pair(lo, false);
   }
 }
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "src/utils/compare.hpp"
+#include "src/utils/thread_policy.hpp"
+
 #include <sys/types.h>
 
 #include <algorithm>
@@ -14,29 +17,29 @@
 namespace collections::b_tree::node {
   constexpr uint ORDER_DEFAULT = 32;
 
-  template<typename K, typename V, uint N>
+  template<typename K, typename V, uint N, typename P, typename C>
   class Node;
 
-  template<typename K, typename V, uint N>
+  template<typename K, typename V, uint N, typename P, typename C>
   class Deep;
 
-  template<typename K, typename V, uint N>
+  template<typename K, typename V, uint N, typename P, typename C>
   class Leaf;
 
-  template<typename K, typename V, uint N>
-  using SharedNode = std::shared_ptr<Node<K, V, N>>;
+  template<typename K, typename V, uint N, typename P, typename C>
+  using SharedNode = typename P::template SharedPtr<Node<K, V, N, P, C>>;
 
-  template<typename K, typename V, uint N>
-  auto make_shared_node(const Deep<K, V, N>& node) -> SharedNode<K, V, N> {
-    return std::static_pointer_cast<Node<K, V, N>>(
-      std::make_shared<Deep<K, V, N>>(node)
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto make_shared_node(const Deep<K, V, N, P, C>& node) -> SharedNode<K, V, N, P, C> {
+    return SharedNode<K, V, N, P, C>(
+      P::template make_shared<Deep<K, V, N, P, C>>(node)
     );
   }
 
-  template<typename K, typename V, uint N>
-  auto make_shared_node(const Leaf<K, V, N>& node) -> SharedNode<K, V, N> {
-    return std::static_pointer_cast<Node<K, V, N>>(
-      std::make_shared<Leaf<K, V, N>>(node)
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto make_shared_node(const Leaf<K, V, N, P, C>& node) -> SharedNode<K, V, N, P, C> {
+    return SharedNode<K, V, N, P, C>(
+      P::template make_shared<Leaf<K, V, N, P, C>>(node)
     );
   }
 
@@ -53,26 +56,30 @@ namespace collections::b_tree::node {
     return std::make_pair(vec, other);
   }
 
-  template<typename K, typename V, uint N>
-  using Split = std::pair<SharedNode<K, V, N>, SharedNode<K, V, N>>;
+  template<typename K, typename V, uint N, typename P, typename C>
+  using Split = std::pair<SharedNode<K, V, N, P, C>, SharedNode<K, V, N, P, C>>;
 
-  template<typename K, typename V, uint N>
-  using Inserted = SharedNode<K, V, N>;
+  template<typename K, typename V, uint N, typename P, typename C>
+  using Inserted = SharedNode<K, V, N, P, C>;
 
-  template<typename K, typename V, uint N>
-  using InsertResult = std::variant<Split<K, V, N>, Inserted<K, V, N>>;
+  template<typename K, typename V, uint N, typename P, typename C>
+  using InsertResult = std::variant<Split<K, V, N, P, C>, Inserted<K, V, N, P, C>>;
 
   template<typename N>
   auto make_result(N&& node) -> InsertResult<
     typename N::KeyType,
     typename N::ValueType,
-    N::ORDER
+    N::ORDER,
+    typename N::PolicyType,
+    typename N::CompareType
   > {
-    return std::static_pointer_cast<Node<
+    return SharedNode<
       typename N::KeyType,
       typename N::ValueType,
-      N::ORDER
-    >>(std::make_shared<N>(node));
+      N::ORDER,
+      typename N::PolicyType,
+      typename N::CompareType
+    >(N::PolicyType::template make_shared<N>(node));
   }
 
   template<typename N>
@@ -82,13 +89,15 @@ namespace collections::b_tree::node {
   ) -> InsertResult<
     typename N::KeyType,
     typename N::ValueType,
-    N::ORDER
+    N::ORDER,
+    typename N::PolicyType,
+    typename N::CompareType
   > {
     return std::make_pair(make_shared_node(left), make_shared_node(right));
   }
 
-  template<typename K, typename V, uint N>
-  auto show(const Node<K, V, N>& node, int indent) -> void {
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto show(const Node<K, V, N, P, C>& node, int indent) -> void {
     auto istr = std::string();
 
     for (auto i = 0; i < indent; i++) {
@@ -96,7 +105,7 @@ namespace collections::b_tree::node {
     }
 
     if (node.is_leaf()) {
-      auto leaf = static_cast<const Leaf<K, V, N>&>(node);
+      auto leaf = static_cast<const Leaf<K, V, N, P, C>&>(node);
 
       std::cout << istr << "Leaf m: " << leaf.measure() << std::endl;
       std::cout << istr << "k: ";
@@ -113,7 +122,7 @@ namespace collections::b_tree::node {
       );
       std::cout << std::endl;
     } else {
-      auto deep = static_cast<const Deep<K, V, N>&>(node);
+      auto deep = static_cast<const Deep<K, V, N, P, C>&>(node);
 
       std::cout << istr << "The Deep m: " << deep.measure() << std::endl;
       for (auto& child : deep.children()) {
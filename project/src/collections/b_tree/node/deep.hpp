@@ -1,8 +1,11 @@
 #pragma once
 
+#include "src/utils/reclaimer.hpp"
+
 #include "src/collections/b_tree/node/core.hpp"
 #include "src/collections/b_tree/node/base.hpp"
 
+#include <algorithm>
 #include <span>
 #include <type_traits>
 #include <utility>
@@ -10,33 +13,41 @@
 #include <vector>
 
 namespace collections::b_tree::node {
-  template<typename K, typename V, uint N>
-  class Deep : public Node<K, V, N> {
+  template<typename K, typename V, uint N, typename P, typename C>
+  class Deep : public Node<K, V, N, P, C> {
     public:
-      using BaseType = Node<K, V, N>;
+      using BaseType = Node<K, V, N, P, C>;
 
     public:
       Deep() = delete;
 
+    public:
+      Deep(Deep<K, V, N, P, C> const& other) = default;
+      Deep(Deep<K, V, N, P, C>&& other) = default;
+
+      // hands the children to Reclaimer::dispose if this is the last
+      // reference to any of them, so they're not destroyed recursively
+      ~Deep();
+
     private:
       Deep(
         std::vector<K>&& keys,
-        std::vector<SharedNode<K, V, N>>&& children,
+        std::vector<SharedNode<K, V, N, P, C>>&& children,
         uint size
       );
 
     public:
       static auto from_children(
-        std::vector<SharedNode<K, V, N>>&& children
-      ) -> Deep<K, V, N>;
+        std::vector<SharedNode<K, V, N, P, C>>&& children
+      ) -> Deep<K, V, N, P, C>;
       static auto from_children(
-        const std::vector<SharedNode<K, V, N>>& children
-      ) -> Deep<K, V, N>;
+        const std::vector<SharedNode<K, V, N, P, C>>& children
+      ) -> Deep<K, V, N, P, C>;
 
     public:
       virtual auto is_leaf() const -> bool override { return false; }
 
-      auto children() const -> std::span<const SharedNode<K, V, N>> {
+      auto children() const -> std::span<const SharedNode<K, V, N, P, C>> {
         return std::span(this->_children);
       }
 
@@ -44,28 +55,47 @@ namespace collections::b_tree::node {
       virtual auto insert(
         const K& key,
         const V& val
-      ) const -> InsertResult<K, V, N> override;
+      ) const -> InsertResult<K, V, N, P, C> override;
 
-       virtual auto get(const K& key) const -> const V* override;
+      template<typename Q>
+      auto get(const Q& key) const -> const V*;
 
     protected:
-      std::vector<SharedNode<K, V, N>> _children;
+      std::vector<SharedNode<K, V, N, P, C>> _children;
   };
 
-  template<typename K, typename V, uint N>
-  Deep<K, V, N>::Deep(
+  template<typename K, typename V, uint N, typename P, typename C>
+  Deep<K, V, N, P, C>::Deep(
     std::vector<K>&& keys,
-    std::vector<SharedNode<K, V, N>>&& children,
+    std::vector<SharedNode<K, V, N, P, C>>&& children,
     uint size
-  ) : Node<K, V, N>(std::move(keys), size), _children(std::move(children)) {
-    this->_keys.reserve(Node<K, V, N>::DEEP_KV_MAX + 1);
-    this->_children.reserve(Node<K, V, N>::CHILD_MAX + 1);
+  ) : Node<K, V, N, P, C>(std::move(keys), size), _children(std::move(children)) {
+    this->_keys.reserve(Node<K, V, N, P, C>::DEEP_KV_MAX + 1);
+    this->_children.reserve(Node<K, V, N, P, C>::CHILD_MAX + 1);
+  }
+
+  template<typename K, typename V, uint N, typename P, typename C>
+  Deep<K, V, N, P, C>::~Deep() {
+    // NOTE: most deep nodes are temporaries sharing all of their children,
+    // those are cheap to destroy in place
+    auto is_last = std::any_of(
+      this->_children.begin(),
+      this->_children.end(),
+      [](SharedNode<K, V, N, P, C> const& child) { return child.use_count() == 1; }
+    );
+
+    if (is_last) {
+      Reclaimer::dispose(
+        new std::vector<SharedNode<K, V, N, P, C>>(std::move(this->_children)),
+        P::IS_LOCAL
+      );
+    }
   }
 
-  template<typename K, typename V, uint N>
-  auto Deep<K, V, N>::from_children(
-    std::vector<SharedNode<K, V, N>>&& children
-  ) -> Deep<K, V, N> {
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto Deep<K, V, N, P, C>::from_children(
+    std::vector<SharedNode<K, V, N, P, C>>&& children
+  ) -> Deep<K, V, N, P, C> {
     std::vector<K> keys;
 
     auto size = 0;
@@ -77,12 +107,12 @@ namespace collections::b_tree::node {
     return Deep(std::move(keys), std::move(children), size);
   }
 
-  template<typename K, typename V, uint N>
-  auto Deep<K, V, N>::from_children(
-    const std::vector<SharedNode<K, V, N>>& children
-  ) -> Deep<K, V, N> {
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto Deep<K, V, N, P, C>::from_children(
+    const std::vector<SharedNode<K, V, N, P, C>>& children
+  ) -> Deep<K, V, N, P, C> {
     std::vector<K> keys;
-    std::vector<SharedNode<K, V, N>> children_copy;
+    std::vector<SharedNode<K, V, N, P, C>> children_copy;
 
     auto size = 0;
     for (auto& child : children) {
@@ -94,23 +124,23 @@ namespace collections::b_tree::node {
     return Deep(std::move(keys), std::move(children_copy), size);
   }
 
-  template<typename K, typename V, uint N>
-  auto Deep<K, V, N>::insert(
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto Deep<K, V, N, P, C>::insert(
     const K& key,
     const V& val
-  ) const -> InsertResult<K, V, N> {
+  ) const -> InsertResult<K, V, N, P, C> {
     std::vector<K> k(this->_keys.begin(), this->_keys.end());
-    std::vector<SharedNode<K, V, N>> c(
+    std::vector<SharedNode<K, V, N, P, C>> c(
       this->children().begin(),
       this->children().end()
     );
 
-    auto idx  = this->index(key);
+    auto idx  = this->index(key).first;
     auto& child = c[idx];
 
     return std::visit([&c, &k, idx, this](auto&& res){
       using T = std::decay_t<decltype(res)>;
-      if constexpr (std::is_same_v<T, Inserted<K, V, N>>) {
+      if constexpr (std::is_same_v<T, Inserted<K, V, N, P, C>>) {
         k[idx] = res->measure();
         c[idx] = std::move(res);
         auto size = 0;
@@ -123,7 +153,7 @@ namespace collections::b_tree::node {
           std::move(c),
           size
         ));
-      } else if constexpr (std::is_same_v<T, Split<K, V, N>>) {
+      } else if constexpr (std::is_same_v<T, Split<K, V, N, P, C>>) {
         auto [left, right] = res;
 
         k[idx] = right->measure();
@@ -131,7 +161,7 @@ namespace collections::b_tree::node {
         c[idx] = std::move(right);
         c.insert(c.begin() + idx, std::move(left));
 
-        if (c.size() == Node<K, V, N>::CHILD_MAX + 1) {
+        if (c.size() == Node<K, V, N, P, C>::CHILD_MAX + 1) {
           auto [kl, kr] = split_vector(std::move(k));
           auto [cl, cr] = split_vector(std::move(c));
 
@@ -154,14 +184,15 @@ namespace collections::b_tree::node {
         }
 
       } else {
-        static_assert(false, "non-exhaustive visitor");
+        static_assert(sizeof(T) == 0, "non-exhaustive visitor");
       }
     }, child->insert(key, val));
   }
 
-  template<typename K, typename V, uint N>
-  auto Deep<K, V, N>::get(const K& key) const -> const V* {
-    auto idx  = this->index(key);
+  template<typename K, typename V, uint N, typename P, typename C>
+  template<typename Q>
+  auto Deep<K, V, N, P, C>::get(const Q& key) const -> const V* {
+    auto idx  = this->index(key).first;
     return this->_children[idx]->get(key);
   }
 }
@@ -10,10 +10,10 @@
 #include <vector>
 
 namespace collections::b_tree::node {
-  template<typename K, typename V, uint N>
-  class Leaf : public Node<K, V, N> {
+  template<typename K, typename V, uint N, typename P, typename C>
+  class Leaf : public Node<K, V, N, P, C> {
     public:
-      using BaseType = Node<K, V, N>;
+      using BaseType = Node<K, V, N, P, C>;
 
     public:
       Leaf() = delete;
@@ -22,15 +22,15 @@ namespace collections::b_tree::node {
       Leaf(std::vector<K>&& keys, std::vector<V>&& vals);
 
     public:
-      static auto empty_root() -> Leaf<K, V, N>;
+      static auto empty_root() -> Leaf<K, V, N, P, C>;
       static auto from_key_values(
         std::vector<K>&& keys,
         std::vector<V>&& vals
-      ) -> Leaf<K, V, N>;
+      ) -> Leaf<K, V, N, P, C>;
       static auto from_key_values(
         const std::vector<K>& keys,
         const std::vector<V>& vals
-      ) -> Leaf<K, V, N>;
+      ) -> Leaf<K, V, N, P, C>;
 
     public:
       virtual auto is_leaf() const -> bool override { return true; }
@@ -41,33 +41,34 @@ namespace collections::b_tree::node {
       virtual auto insert(
         const K& key,
         const V& val
-      ) const -> InsertResult<K, V, N> override;
+      ) const -> InsertResult<K, V, N, P, C> override;
 
-      virtual auto get(const K& key) const -> const V* override;
+      template<typename Q>
+      auto get(const Q& key) const -> const V*;
 
     protected:
       std::vector<V> _vals;
   };
 
-  template<typename K, typename V, uint N>
-  Leaf<K, V, N>::Leaf(
+  template<typename K, typename V, uint N, typename P, typename C>
+  Leaf<K, V, N, P, C>::Leaf(
     std::vector<K>&& keys,
     std::vector<V>&& vals
-  ) : Node<K, V, N>(std::move(keys), vals.size()), _vals(std::move(vals)) {
-    this->_keys.reserve(Node<K, V, N>::LEAF_KV_MAX + 1);
-    this->_vals.reserve(Node<K, V, N>::LEAF_KV_MAX + 1);
+  ) : Node<K, V, N, P, C>(std::move(keys), vals.size()), _vals(std::move(vals)) {
+    this->_keys.reserve(Node<K, V, N, P, C>::LEAF_KV_MAX + 1);
+    this->_vals.reserve(Node<K, V, N, P, C>::LEAF_KV_MAX + 1);
   }
 
-  template<typename K, typename V, uint N>
-  auto Leaf<K, V, N>::empty_root() -> Leaf<K, V, N> {
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto Leaf<K, V, N, P, C>::empty_root() -> Leaf<K, V, N, P, C> {
     return Leaf({}, {});
   }
 
-  template<typename K, typename V, uint N>
-  auto Leaf<K, V, N>::from_key_values(
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto Leaf<K, V, N, P, C>::from_key_values(
     std::vector<K>&& keys,
     std::vector<V>&& vals
-  ) -> Leaf<K, V, N> {
+  ) -> Leaf<K, V, N, P, C> {
     if (keys.size() != vals.size()) {
       // TODO: throw proper exception
       throw 1;
@@ -76,11 +77,11 @@ namespace collections::b_tree::node {
     return Leaf(std::move(keys), std::move(vals));
   }
 
-  template<typename K, typename V, uint N>
-  auto Leaf<K, V, N>::from_key_values(
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto Leaf<K, V, N, P, C>::from_key_values(
     const std::vector<K>& keys,
     const std::vector<V>& vals
-  ) -> Leaf<K, V, N> {
+  ) -> Leaf<K, V, N, P, C> {
     if (keys.size() != vals.size()) {
       // TODO: throw proper exception
       throw 1;
@@ -97,23 +98,23 @@ namespace collections::b_tree::node {
     return Leaf(std::move(keys_copy), std::move(vals_copy));
   }
 
-  template<typename K, typename V, uint N>
-  auto Leaf<K, V, N>::insert(
+  template<typename K, typename V, uint N, typename P, typename C>
+  auto Leaf<K, V, N, P, C>::insert(
     const K& key,
     const V& val
-  ) const -> InsertResult<K, V, N> {
+  ) const -> InsertResult<K, V, N, P, C> {
     std::vector<K> k(this->keys().begin(), this->keys().end());
     std::vector<V> v(this->vals().begin(), this->vals().end());
 
-    auto idx = this->index(key);
+    auto [idx, found] = this->index(key);
 
-    if (idx < k.size() && k[idx] == key) {
+    if (found) {
       v[idx] = val;
     } else {
       k.insert(k.begin() + idx, key);
       v.insert(v.begin() + idx, val);
 
-      if (v.size() == Node<K, V, N>::LEAF_KV_MAX + 1) {
+      if (v.size() == Node<K, V, N, P, C>::LEAF_KV_MAX + 1) {
         auto [kl, kr] = split_vector(std::move(k));
         auto [vl, vr] = split_vector(std::move(v));
 
@@ -127,10 +128,11 @@ namespace collections::b_tree::node {
     return make_result(Leaf(std::move(k), std::move(v)));
   }
 
-  template<typename K, typename V, uint N>
-  auto Leaf<K, V, N>::get(const K& key) const -> const V* {
-    auto idx  = this->index(key);
-    if (idx < this->_keys.size() && this->_keys[idx] == key) {
+  template<typename K, typename V, uint N, typename P, typename C>
+  template<typename Q>
+  auto Leaf<K, V, N, P, C>::get(const Q& key) const -> const V* {
+    auto [idx, found] = this->index(key);
+    if (found) {
       return &this->_vals[idx];
     } else {
       return nullptr;
@@ -6,18 +6,18 @@
 #include "src/collections/finger_tree/node/core.hpp"
 
 namespace collections::finger_tree {
-  template<typename K, typename V>
-  using Node = node::Node<K, V>;
+  template<typename K, typename V, typename M>
+  using Node = node::Node<K, V, M>;
 
-  template<typename K, typename V>
-  using NodeBase = node::NodeBase<K, V>;
+  template<typename K, typename V, typename M>
+  using NodeBase = node::NodeBase<K, V, M>;
 
-  template<typename K, typename V>
-  using NodeDeep = node::NodeDeep<K, V>;
+  template<typename K, typename V, typename M>
+  using NodeDeep = node::NodeDeep<K, V, M>;
 
-  template<typename K, typename V>
-  using NodeLeaf = node::NodeLeaf<K, V>;
+  template<typename K, typename V, typename M>
+  using NodeLeaf = node::NodeLeaf<K, V, M>;
 
-  template<typename K, typename V>
-  using Digits = digit::Digits<K, V>;
+  template<typename K, typename V, typename M>
+  using Digits = digit::Digits<K, V, M>;
 }
@@ -1,27 +1,39 @@
 #pragma once
 
 // the base type of the finger tree variants
+//
+// the variants have no virtual methods, the wrapper type knows which variant
+// it points to from the tag of its pointer and dispatches on it
 
 #include "src/collections/finger_tree/core.hpp"
+#include "src/collections/finger_tree/measure.hpp"
 
-#include <ostream>
-#include <sys/types.h>
+#include <cstddef>
 
 namespace collections::finger_tree {
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class FingerTreeBase {
     // constructors
     protected:
       FingerTreeBase() = default;
 
-    // helpers
+    // allocation
     public:
-      // print a debug representation of the tree with the given indent
-      virtual auto show(std::ostream& os, uint indent) const -> std::ostream& = 0;
-  };
+      // NOTE: the variants are always deleted as their own type, so the size
+      // passed here is the one they were allocated with
+      static auto operator new(std::size_t size) -> void* {
+        return measure::ThreadPolicyOf<M>::Type::allocate(size);
+      }
+
+      static auto operator delete(void* ptr, std::size_t size) -> void {
+        measure::ThreadPolicyOf<M>::Type::deallocate(ptr, size);
+      }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, FingerTreeBase<K, V> const& tree) {
-    return tree.show(os, 0);
-  }
+    private:
+      // the number of FingerTree instances referring to this variant
+      typename measure::ThreadPolicyOf<M>::Type::RefCount _refs;
+
+      // give the wrapper type access to the reference count
+      friend class FingerTree<K, V, M>;
+  };
 }
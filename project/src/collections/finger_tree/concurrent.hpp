@@ -0,0 +1,243 @@
+#pragma once
+
+// an atomically published finger tree for concurrent readers and writers
+//
+// the handle holds the current version of a tree behind an atomic pointer,
+// readers take snapshots by copying the tree of the current version, which
+// only acquires a reference to its root, or read it in place without
+// acquiring anything, writers modify a snapshot and publish it as the next
+// version with a compare and swap
+//
+// replaced versions are reclaimed through an epoch domain (see
+// src/utils/epoch.hpp), so readers never touch the reference counts of
+// versions, the trees themselves stay reference counted, their nodes are
+// shared between versions and freed deterministically once no version or
+// snapshot refers to them
+//
+// a tree is only modified in place if nobody else refers to it (see
+// FingerTree::ensure_unique), the published version always holds a reference
+// to its tree, so a writer modifying its snapshot copies the path it touches
+// and never writes to nodes a reader may see, for this to hold the published
+// tree itself is never handed out for modification, it is const and only
+// reachable through copies
+
+#include "src/utils/epoch.hpp"
+
+#include "src/collections/finger_tree/_prelude.hpp"
+#include "src/collections/finger_tree/core.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+#include <type_traits>
+#include <utility>
+
+namespace collections::finger_tree {
+  template<typename K, typename V, typename M>
+  class ConcurrentFingerTree {
+    static_assert(
+      !measure::ThreadPolicyOf<M>::Type::IS_LOCAL,
+      "thread local trees can't be shared between threads"
+    );
+
+    // constructors
+    public:
+      // create a handle publishing an empty tree as version 0
+      ConcurrentFingerTree();
+
+      // create a handle publishing the given tree as version 0
+      ConcurrentFingerTree(FingerTree<K, V, M> const& tree);
+
+      // the handle is the point of synchronization, copies would not see
+      // each others versions
+      ConcurrentFingerTree(ConcurrentFingerTree<K, V, M> const& other) = delete;
+      auto operator=(
+        ConcurrentFingerTree<K, V, M> const& other
+      ) -> ConcurrentFingerTree<K, V, M>& = delete;
+
+      // no reader or writer may use the handle while it's destroyed
+      ~ConcurrentFingerTree();
+
+    // accessors
+    public:
+      // return the number of the currently published version
+      auto version() const -> std::uint64_t;
+
+    // methods
+    public:
+      // return a snapshot of the currently published tree in O(1), it's not
+      // affected by later versions and may be freely modified by the caller
+      auto snapshot() const -> FingerTree<K, V, M>;
+
+      // return the currently published version number and tree, the number
+      // can be passed to compare_exchange after modifying the tree
+      auto load() const -> std::pair<std::uint64_t, FingerTree<K, V, M>>;
+
+      // call func with the currently published tree and return its result,
+      // unlike snapshot this does no atomic read modify write at all, the
+      // tree must not be used after func returns, copy it to keep it
+      //
+      //   func(FingerTree<K, V, M> const& tree) -> T
+      template<typename F>
+      auto read(F const& func) const -> std::invoke_result_t<F const&, FingerTree<K, V, M> const&>;
+
+      // publish the given tree as the next version if the given version is
+      // still the current one and return whether it was published
+      auto compare_exchange(std::uint64_t expected, FingerTree<K, V, M> const& desired) -> bool;
+
+      // publish the given tree as the next version regardless of the current
+      // one and return the new version number
+      auto store(FingerTree<K, V, M> const& tree) -> std::uint64_t;
+
+      // apply func to a snapshot and publish the result, if another writer
+      // published a version in the meantime func is applied again to a new
+      // snapshot, so it should not have other side effects, with a single
+      // writer this never retries
+      //
+      //   func(FingerTree<K, V, M>& tree) -> void
+      //
+      // return the published tree
+      template<typename F>
+      auto update(F const& func) -> FingerTree<K, V, M>;
+
+    private:
+      struct Version {
+        std::uint64_t number;
+
+        // NOTE: const, so the published tree is never written to, not even if
+        // the version holds the only reference to it
+        FingerTree<K, V, M> const tree;
+      };
+
+      // publish the given tree as the successor of the given version and
+      // retire it, on failure current is set to the published version, the
+      // calling thread must be inside the domain
+      auto publish(Version const*& current, FingerTree<K, V, M> const& tree) -> bool;
+
+    private:
+      // NOTE: a version is only retired after it was replaced, so while a
+      // thread is inside the domain any version it loaded stays alive and its
+      // address can't be reused by a new version
+      std::atomic<Version const*> _current;
+      mutable EpochDomain _domain;
+  };
+
+  template<typename K, typename V, typename M>
+  ConcurrentFingerTree<K, V, M>::ConcurrentFingerTree()
+    : ConcurrentFingerTree(FingerTree<K, V, M>()) {}
+
+  template<typename K, typename V, typename M>
+  ConcurrentFingerTree<K, V, M>::ConcurrentFingerTree(
+    FingerTree<K, V, M> const& tree
+  ) : _current(nullptr), _domain() {
+    tree.assert_init();
+    this->_current.store(new Version{0, tree}, std::memory_order_release);
+  }
+
+  template<typename K, typename V, typename M>
+  ConcurrentFingerTree<K, V, M>::~ConcurrentFingerTree() {
+    // NOTE: the domain destroys the retired versions afterwards
+    delete this->_current.load(std::memory_order_acquire);
+  }
+
+  template<typename K, typename V, typename M>
+  auto ConcurrentFingerTree<K, V, M>::version() const -> std::uint64_t {
+    EpochDomain::Guard guard(this->_domain);
+    return this->_current.load(std::memory_order_acquire)->number;
+  }
+
+  template<typename K, typename V, typename M>
+  auto ConcurrentFingerTree<K, V, M>::snapshot() const -> FingerTree<K, V, M> {
+    EpochDomain::Guard guard(this->_domain);
+    return this->_current.load(std::memory_order_acquire)->tree;
+  }
+
+  template<typename K, typename V, typename M>
+  auto ConcurrentFingerTree<K, V, M>::load() const
+    -> std::pair<std::uint64_t, FingerTree<K, V, M>>
+  {
+    EpochDomain::Guard guard(this->_domain);
+    auto current = this->_current.load(std::memory_order_acquire);
+    return std::pair(current->number, current->tree);
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename F>
+  auto ConcurrentFingerTree<K, V, M>::read(
+    F const& func
+  ) const -> std::invoke_result_t<F const&, FingerTree<K, V, M> const&> {
+    EpochDomain::Guard guard(this->_domain);
+    return func(this->_current.load(std::memory_order_acquire)->tree);
+  }
+
+  template<typename K, typename V, typename M>
+  auto ConcurrentFingerTree<K, V, M>::compare_exchange(
+    std::uint64_t expected,
+    FingerTree<K, V, M> const& desired
+  ) -> bool {
+    desired.assert_init();
+
+    EpochDomain::Guard guard(this->_domain);
+    auto current = this->_current.load(std::memory_order_acquire);
+    if (current->number != expected) {
+      return false;
+    }
+
+    // NOTE: we're inside the domain, so the address of the expected version
+    // can't be reused by another version before the swap
+    return this->publish(current, desired);
+  }
+
+  template<typename K, typename V, typename M>
+  auto ConcurrentFingerTree<K, V, M>::store(FingerTree<K, V, M> const& tree) -> std::uint64_t {
+    tree.assert_init();
+
+    EpochDomain::Guard guard(this->_domain);
+    auto current = this->_current.load(std::memory_order_acquire);
+    while (!this->publish(current, tree)) {}
+
+    return current->number + 1;
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename F>
+  auto ConcurrentFingerTree<K, V, M>::update(F const& func) -> FingerTree<K, V, M> {
+    while (true) {
+      // NOTE: the snapshot holds its own reference to the tree, so func runs
+      // outside the domain and a slow update doesn't hold back reclaiming
+      // replaced versions, the domain is only entered again to publish
+      //
+      // the snapshot shares its root with the published tree, so func copies
+      // everything it modifies
+      auto [expected, tree] = this->load();
+      func(tree);
+      tree.assert_init();
+
+      if (this->compare_exchange(expected, tree)) {
+        return tree;
+      }
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto ConcurrentFingerTree<K, V, M>::publish(
+    Version const*& current,
+    FingerTree<K, V, M> const& tree
+  ) -> bool {
+    auto next = new Version{current->number + 1, tree};
+
+    if (!this->_current.compare_exchange_strong(
+      current,
+      next,
+      std::memory_order_acq_rel,
+      std::memory_order_acquire
+    )) {
+      delete next;
+      return false;
+    }
+
+    auto replaced = current;
+    this->_domain.retire([replaced]() { delete replaced; });
+    return true;
+  }
+}
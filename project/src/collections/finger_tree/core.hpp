@@ -2,26 +2,47 @@
 
 // forward delarations
 
+#include "src/collections/finger_tree/measure.hpp"
+
 namespace collections::finger_tree {
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class FingerTreeEmpty;
 
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class FingerTreeSingle;
 
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class FingerTreeDeep;
 
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class FingerTreeBase;
 
-  template<typename K, typename V>
+  template<typename K, typename V, typename M = measure::Unit<K, V>>
   class FingerTree;
 
+  template<typename K, typename V, typename M>
+  class Suspension;
+
+  template<typename K, typename V, typename M = measure::Unit<K, V>>
+  class Transient;
+
+  template<typename K, typename V, typename M>
+  class Iterator;
+
+  template<typename K, typename V, typename M = measure::Unit<K, V>>
+  class ConcurrentFingerTree;
+
+  // a finger tree with non-atomic reference counts, which must never leave
+  // the thread it was created on
+  template<typename K, typename V>
+  using LocalFingerTree = FingerTree<K, V, measure::Local<measure::Unit<K, V>>>;
+
   enum class Direction { Left, Right };
 
   enum class Kind { Deep, Single, Empty };
 
+  enum class Execution { Sequential, Parallel };
+
   namespace collections::node {}
 
   namespace collections::digit {}
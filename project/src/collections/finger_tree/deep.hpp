@@ -6,68 +6,92 @@
 
 #include "src/collections/finger_tree/_prelude.hpp"
 #include "src/collections/finger_tree/core.hpp"
+#include "src/collections/finger_tree/suspension.hpp"
 
 #include <ostream>
 #include <sys/types.h>
+#include <type_traits>
 
 namespace collections::finger_tree {
-  template<typename K, typename V>
-  class FingerTreeDeep : public FingerTreeBase<K, V> {
+  template<typename K, typename V, typename M>
+  class FingerTreeDeep : public FingerTreeBase<K, V, M> {
     // constructors
     public:
       FingerTreeDeep(
-        Digits<K, V> const& left,
-        FingerTree<K, V> const& middle,
-        Digits<K, V> const& right
+        Digits<K, V, M> const& left,
+        Suspension<K, V, M> const& middle,
+        Digits<K, V, M> const& right
       );
 
     // accessors
     public:
       auto key() const -> const K& { return this->_right.key(); }
+      auto measure() const -> typename M::Type const& { return this->_measure; }
 
-      // we include mutable accessors for the ensure_unique optimization, they
-      // are however not used atm
-      auto left() -> Digits<K, V>& { return this->_left; }
-      auto left() const -> Digits<K, V> const& { return this->_left; }
+      // mutable accessors for in place modification, these must only be used
+      // after the owning tree was made unique
+      auto left() -> Digits<K, V, M>& { return this->_left; }
+      auto left() const -> Digits<K, V, M> const& { return this->_left; }
 
-      auto middle() -> FingerTree<K, V>& { return this->_middle; }
-      auto middle() const -> FingerTree<K, V> const& { return this->_middle; }
+      // accessing the middle tree forces it, use lazy_middle to avoid this
+      auto middle() const -> FingerTree<K, V, M> const& { return this->_middle.force(); }
+      auto lazy_middle() -> Suspension<K, V, M>& { return this->_middle; }
+      auto lazy_middle() const -> Suspension<K, V, M> const& { return this->_middle; }
 
-      auto right() -> Digits<K, V>& { return this->_right; }
-      auto right() const -> Digits<K, V> const& { return this->_right; }
+      auto right() -> Digits<K, V, M>& { return this->_right; }
+      auto right() const -> Digits<K, V, M> const& { return this->_right; }
 
     // helpers
     protected:
+      // recompute the cached measure after the digits or middle tree were
+      // modified in place
+      auto update_measure() -> void;
+
       // print a debug representation of the tree with the given indent
-      virtual auto show(std::ostream& os, uint indent) const -> std::ostream& override;
+      auto show(std::ostream& os, uint indent) const -> std::ostream&;
 
     private:
       // we cache the size of this directly, the key can be accessed using the
       // _right digits field
       uint _size;
 
-      Digits<K, V> _left;
-      FingerTree<K, V> _middle;
-      Digits<K, V> _right;
+      // the measure of the whole tree, this takes no space for empty measures
+      [[no_unique_address]] typename M::Type _measure;
+
+      Digits<K, V, M> _left;
+      Suspension<K, V, M> _middle;
+      Digits<K, V, M> _right;
 
       // give the wrapper type access to this variant's internals
-      friend class FingerTree<K, V>;
+      friend class FingerTree<K, V, M>;
   };
 
-  template<typename K, typename V>
-  FingerTreeDeep<K, V>::FingerTreeDeep(
-    Digits<K, V> const& left,
-    FingerTree<K, V> const& middle,
-    Digits<K, V> const& right
-  ) : _left(left), _middle(middle), _right(right) {
+  template<typename K, typename V, typename M>
+  FingerTreeDeep<K, V, M>::FingerTreeDeep(
+    Digits<K, V, M> const& left,
+    Suspension<K, V, M> const& middle,
+    Digits<K, V, M> const& right
+  ) : _size(0), _measure(), _left(left), _middle(middle), _right(right) {
     // the size of this tree must be the sum of its parts sizes
     this->_size += this->_left.size();
     this->_size += this->_middle.size();
     this->_size += this->_right.size();
+    this->update_measure();
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTreeDeep<K, V, M>::update_measure() -> void {
+    // NOTE: this would force the middle tree for nothing
+    if constexpr (!std::is_empty_v<typename M::Type>) {
+      this->_measure = M::combine(
+        M::combine(this->_left.measure(), this->_middle.measure()),
+        this->_right.measure()
+      );
+    }
   }
 
-  template<typename K, typename V>
-  auto FingerTreeDeep<K, V>::show(std::ostream& os, uint indent) const -> std::ostream& {
+  template<typename K, typename V, typename M>
+  auto FingerTreeDeep<K, V, M>::show(std::ostream& os, uint indent) const -> std::ostream& {
     auto istr2 = std::string((indent + 1) * 2, ' ');
 
     os << "Deep" << std::endl;
@@ -76,7 +100,7 @@ namespace collections::finger_tree {
     os << std::endl;
 
     os << istr2;
-    this->_middle.show(os, indent + 1);
+    this->_middle.force().show(os, indent + 1);
     os << std::endl;
 
     os << istr2 << "Right ";
@@ -84,8 +108,8 @@ namespace collections::finger_tree {
     return os;
   }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, FingerTreeDeep<K, V> const& tree) {
+  template<typename K, typename V, typename M>
+  std::ostream& operator<<(std::ostream& os, FingerTreeDeep<K, V, M> const& tree) {
     return tree.show(os, 0);
   }
 }
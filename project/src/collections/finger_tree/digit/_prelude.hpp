@@ -5,15 +5,15 @@
 #include "src/collections/finger_tree/node/core.hpp"
 
 namespace collections::finger_tree::digit {
-  template<typename K, typename V>
-  using Node = node::Node<K, V>;
+  template<typename K, typename V, typename M>
+  using Node = node::Node<K, V, M>;
 
-  template<typename K, typename V>
-  using NodeBase = node::NodeBase<K, V>;
+  template<typename K, typename V, typename M>
+  using NodeBase = node::NodeBase<K, V, M>;
 
-  template<typename K, typename V>
-  using NodeDeep = node::NodeDeep<K, V>;
+  template<typename K, typename V, typename M>
+  using NodeDeep = node::NodeDeep<K, V, M>;
 
-  template<typename K, typename V>
-  using NodeLeaf = node::NodeLeaf<K, V>;
+  template<typename K, typename V, typename M>
+  using NodeLeaf = node::NodeLeaf<K, V, M>;
 }
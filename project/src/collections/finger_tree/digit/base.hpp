@@ -1,54 +1,66 @@
 #pragma once
 
-// the only digit variant, this is only used for the separation for persistence
-// digits allow 0 and more than 4 elements to avoid excessive copying in
+// the storage of digits, the nodes are stored inline
+// digits allow 0 and up to 5 elements to avoid excessive copying in
 // over/underflow scenarios
 
+#include "src/utils/key_search.hpp"
+
 #include "src/collections/finger_tree/core.hpp"
 #include "src/collections/finger_tree/digit/_prelude.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <optional>
 #include <span>
+#include <stdexcept>
 #include <sys/types.h>
-#include <vector>
+#include <type_traits>
+#include <utility>
 
 namespace collections::finger_tree::digit {
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class DigitsBase {
     // constructors
     public:
-      DigitsBase() = default;
+      DigitsBase();
 
       // create various digits depending on the number of nodes inside them
-      DigitsBase(Node<K, V> const& a);
-      DigitsBase(Node<K, V> const& a, Node<K, V> const& b);
-      DigitsBase(Node<K, V> const& a, Node<K, V> const& b, Node<K, V> const& c);
+      DigitsBase(Node<K, V, M> const& a);
+      DigitsBase(Node<K, V, M> const& a, Node<K, V, M> const& b);
+      DigitsBase(Node<K, V, M> const& a, Node<K, V, M> const& b, Node<K, V, M> const& c);
       DigitsBase(
-        Node<K, V> const& a,
-        Node<K, V> const& b,
-        Node<K, V> const& c,
-        Node<K, V> const& d
+        Node<K, V, M> const& a,
+        Node<K, V, M> const& b,
+        Node<K, V, M> const& c,
+        Node<K, V, M> const& d
       );
 
     // accessors
     public:
       auto size() const -> uint { return this->_size; }
-      auto digit_size() const -> uint { return this->_digits.size(); }
-      auto key() const -> K const& { return this->_digits.back().key(); }
-      auto digits() const -> std::span<Node<K, V> const> {
-        return std::span(this->_digits);
+      auto digit_size() const -> uint { return this->_count; }
+      auto key() const -> K const&;
+      auto digits() const -> std::span<Node<K, V, M> const> {
+        return std::span(this->_digits, this->_count);
       }
-      auto left() -> Node<K, V> const& { return this->_digits.front(); }
-      auto right() -> Node<K, V> const& { return this->_digits.back(); }
+      auto left() const -> Node<K, V, M> const& { return this->_digits[0]; }
+      auto right() const -> Node<K, V, M> const& { return this->_digits[this->_count - 1]; }
 
     // methods
     public:
+      // return the index of the first node whose key is not less than the
+      // given key, or the number of nodes if there is none
+      template<typename Q>
+      auto find(Q const& key) const -> uint;
+
       // return a pointer to the value this key refers to, or a nullptr if the
       // key didn't exist
-      auto get(K const& key) const -> V const*;
+      template<typename Q>
+      auto get(Q const& key) const -> V const*;
 
       // add a node at the given side
-      auto push(Direction dir, Node<K, V> const& node) -> void;
+      auto push(Direction dir, Node<K, V, M> const& node) -> void;
 
       // pop a node from the given side
       // undefined behavior if called on empty digits
@@ -56,12 +68,26 @@ namespace collections::finger_tree::digit {
 
       // unpack a deep node and add its children
       // this is used for underflow
-      auto unpack(Direction dir, NodeDeep<K, V> const& node) -> void;
+      auto unpack(Direction dir, NodeDeep<K, V, M> const& node) -> void;
 
       // pack nodes from the given side and return them
       // this is used for overflow
       // undefined behavior if called on less than 3 digits
-      auto pack(Direction dir) -> NodeDeep<K, V>;
+      auto pack(Direction dir) -> Node<K, V, M>;
+
+      // insert the given leaf into the node the key would be found in and
+      // return the old value if the key existed
+      //
+      // if that node overflows, its new sibling is added next to it, which
+      // may leave these digits with five nodes
+      auto insert(K const& key, Node<K, V, M> const& leaf) -> std::optional<V>;
+
+      // remove the leaf with the given key and return its value if it existed
+      //
+      // if a node is dissolved and has no sibling in these digits, its
+      // remaining child is returned alongside the value, which leaves these
+      // digits empty
+      auto remove(K const& key) -> std::pair<std::optional<V>, std::optional<Node<K, V, M>>>;
 
     // helpers
     public:
@@ -71,100 +97,120 @@ namespace collections::finger_tree::digit {
       // print a debug representation of the tree with the given indent
       auto show(std::ostream& os, uint indent) const -> std::ostream&;
 
+    private:
+      // insert a node at the given index, throwing an exception if these
+      // digits are full, this does not update the size
+      auto insert_at(uint index, Node<K, V, M> const& node) -> void;
+
+      // remove the node at the given index, this does not update the size
+      auto erase_at(uint index) -> void;
+
     private:
       // we cache the size of this directly, the key can be accessed using the
       // last node
       uint _size;
-      std::vector<Node<K, V>> _digits;
+
+      // the nodes are stored inline, the slots after _count are uninitialized
+      // nodes
+      uint _count;
+      Node<K, V, M> _digits[5];
+
+      // the keys of the nodes, see NodeDeep
+      using Keys = key_search::InlineKeys<K, typename measure::CompareOf<K, M>::Type, 8>;
+      [[no_unique_address]] Keys _keys;
   };
 
-  template<typename K, typename V>
-  DigitsBase<K, V>::DigitsBase(
-    Node<K, V> const& a
-  ) : _size(0), _digits() {
-    this->_size += a.size();
-    this->_digits.reserve(5);
-    this->_digits.emplace_back(a);
-  }
-
-  template<typename K, typename V>
-  DigitsBase<K, V>::DigitsBase(
-    Node<K, V> const& a,
-    Node<K, V> const& b
-  ) : _size(0), _digits() {
-    this->_size += a.size();
-    this->_size += b.size();
-    this->_digits.reserve(5);
-    this->_digits.emplace_back(a);
-    this->_digits.emplace_back(b);
-  }
-
-  template<typename K, typename V>
-  DigitsBase<K, V>::DigitsBase(
-    Node<K, V> const& a,
-    Node<K, V> const& b,
-    Node<K, V> const& c
-  ) : _size(0), _digits() {
-    this->_size += a.size();
-    this->_size += b.size();
-    this->_size += c.size();
-    this->_digits.reserve(5);
-    this->_digits.emplace_back(a);
-    this->_digits.emplace_back(b);
-    this->_digits.emplace_back(c);
-  }
-
-  template<typename K, typename V>
-  DigitsBase<K, V>::DigitsBase(
-    Node<K, V> const& a,
-    Node<K, V> const& b,
-    Node<K, V> const& c,
-    Node<K, V> const& d
-  ) : _size(0), _digits() {
-    this->_size += a.size();
-    this->_size += b.size();
-    this->_size += c.size();
-    this->_size += d.size();
-    this->_digits.reserve(5);
-    this->_digits.emplace_back(a);
-    this->_digits.emplace_back(b);
-    this->_digits.emplace_back(c);
-    this->_digits.emplace_back(d);
-  }
-
-  template<typename K, typename V>
-  auto DigitsBase<K, V>::get(K const& key) const -> V const* {
-    for (const auto& digit : this->_digits) {
-      if (digit.key() >= key) {
-        return digit.get(key);
-      }
-    }
+  template<typename K, typename V, typename M>
+  DigitsBase<K, V, M>::DigitsBase() : _size(0), _count(0), _digits() {}
 
-    return nullptr;
+  template<typename K, typename V, typename M>
+  DigitsBase<K, V, M>::DigitsBase(
+    Node<K, V, M> const& a
+  ) : _size(a.size()), _count(1), _digits{a} {
+    this->_keys.set(0, a);
   }
 
-  template<typename K, typename V>
-  auto DigitsBase<K, V>::push(Direction dir, Node<K, V> const& node) -> void {
-    if (dir == Direction::Left) {
-      this->_digits.emplace(this->_digits.cbegin(), node);
+  template<typename K, typename V, typename M>
+  DigitsBase<K, V, M>::DigitsBase(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b
+  ) : _size(a.size() + b.size()), _count(2), _digits{a, b} {
+    this->_keys.set(0, a);
+    this->_keys.set(1, b);
+  }
+
+  template<typename K, typename V, typename M>
+  DigitsBase<K, V, M>::DigitsBase(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b,
+    Node<K, V, M> const& c
+  ) : _size(a.size() + b.size() + c.size()), _count(3), _digits{a, b, c} {
+    this->_keys.set(0, a);
+    this->_keys.set(1, b);
+    this->_keys.set(2, c);
+  }
+
+  template<typename K, typename V, typename M>
+  DigitsBase<K, V, M>::DigitsBase(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b,
+    Node<K, V, M> const& c,
+    Node<K, V, M> const& d
+  ) : _size(a.size() + b.size() + c.size() + d.size()), _count(4), _digits{a, b, c, d} {
+    this->_keys.set(0, a);
+    this->_keys.set(1, b);
+    this->_keys.set(2, c);
+    this->_keys.set(3, d);
+  }
+
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::key() const -> K const& {
+    if constexpr (Keys::IS_ENABLED) {
+      return this->_keys[this->_count - 1];
     } else {
-      this->_digits.emplace_back(node);
+      return this->_digits[this->_count - 1].key();
     }
   }
 
-  template<typename K, typename V>
-  auto DigitsBase<K, V>::pop(Direction dir) -> void {
-    if (dir == Direction::Left) {
-      this->_digits.erase(this->_digits.cbegin());
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto DigitsBase<K, V, M>::find(Q const& key) const -> uint {
+    if constexpr (Keys::IS_ENABLED && std::is_same_v<Q, K>) {
+      return this->_keys.lower_bound(key);
     } else {
-      this->_digits.pop_back();
+      uint i = 0;
+      while (i < this->_count && measure::compare<K, M>(this->_digits[i].key(), key) < 0) {
+        i++;
+      }
+
+      return i;
     }
   }
 
-  template<typename K, typename V>
-  auto DigitsBase<K, V>::unpack(
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto DigitsBase<K, V, M>::get(Q const& key) const -> V const* {
+    uint i = this->find(key);
+    return i < this->_count ? this->_digits[i].get(key) : nullptr;
+  }
+
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::push(Direction dir, Node<K, V, M> const& node) -> void {
+    this->_size += node.size();
+    this->insert_at(dir == Direction::Left ? 0 : this->_count, node);
+  }
+
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::pop(Direction dir) -> void {
+    uint i = dir == Direction::Left ? 0 : this->_count - 1;
+    this->_size -= this->_digits[i].size();
+    this->erase_at(i);
+  }
+
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::unpack(
     Direction dir,
-    NodeDeep<K, V> const& node
+    NodeDeep<K, V, M> const& node
   ) -> void {
     if (dir == Direction::Left) {
       for (auto it = node.children().rbegin(); it != node.children().rend(); it++) {
@@ -177,34 +223,126 @@ namespace collections::finger_tree::digit {
     }
   }
 
-  template<typename K, typename V>
-  auto DigitsBase<K, V>::pack(Direction dir) -> NodeDeep<K, V> {
-    if (dir == Direction::Left) {
-      auto a = this->left();
-      this->pop(Direction::Left);
-      auto b = this->left();
-      this->pop(Direction::Left);
-      auto c = this->left();
-      this->pop(Direction::Left);
-      return NodeDeep<K, V>(a, b, c);
-    } else {
-      auto c = this->right();
-      this->pop(Direction::Left);
-      auto b = this->right();
-      this->pop(Direction::Left);
-      auto a = this->right();
-      this->pop(Direction::Left);
-      return NodeDeep<K, V>(a, b, c);
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::pack(Direction dir) -> Node<K, V, M> {
+    uint i = dir == Direction::Left ? 0 : this->_count - 3;
+    auto packed = Node<K, V, M>(this->_digits[i], this->_digits[i + 1], this->_digits[i + 2]);
+    this->_size -= packed.size();
+
+    this->erase_at(i);
+    this->erase_at(i);
+    this->erase_at(i);
+    return packed;
+  }
+
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::insert(
+    K const& key,
+    Node<K, V, M> const& leaf
+  ) -> std::optional<V> {
+    // NOTE: keys greater than the key of these digits are inserted into the
+    // last node
+    uint i = std::min(this->find(key), this->_count - 1);
+
+    auto inserted = this->_digits[i].insert(key, leaf);
+    if (!inserted.found) {
+      this->_size += 1;
     }
+
+    this->_keys.set(i, this->_digits[i]);
+    if (inserted.overflow) {
+      this->insert_at(i + 1, *inserted.overflow);
+    }
+
+    return std::move(inserted.found);
+  }
+
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::remove(
+    K const& key
+  ) -> std::pair<std::optional<V>, std::optional<Node<K, V, M>>> {
+    uint i = this->find(key);
+    if (i == this->_count) {
+      return std::pair(std::optional<V>(), std::optional<Node<K, V, M>>());
+    }
+
+    auto removed = this->_digits[i].remove(key);
+    if (!removed.found) {
+      return std::pair(std::optional<V>(), std::optional<Node<K, V, M>>());
+    }
+
+    this->_size -= 1;
+
+    std::optional<Node<K, V, M>> orphan;
+    if (removed.underflow) {
+      // the node was dissolved, merge its remaining child into a sibling in
+      // these digits if possible
+      if (i > 0) {
+        auto [a, b] = this->_digits[i - 1].merge(Direction::Right, *removed.underflow);
+        this->_digits[i - 1] = a;
+        if (b) {
+          this->_digits[i] = *b;
+        } else {
+          this->erase_at(i);
+        }
+      } else if (i + 1 < this->_count) {
+        auto [a, b] = this->_digits[i + 1].merge(Direction::Left, *removed.underflow);
+        this->_digits[i] = a;
+        if (b) {
+          this->_digits[i + 1] = *b;
+        } else {
+          this->erase_at(i + 1);
+        }
+      } else {
+        this->erase_at(i);
+        this->_size -= removed.underflow->size();
+        orphan = removed.underflow;
+      }
+    } else if (removed.erased) {
+      this->erase_at(i);
+    }
+
+    // NOTE: the nodes next to the removed key may have been modified in place
+    for (uint j = i > 0 ? i - 1 : 0; j < this->_count && j <= i + 1; j++) {
+      this->_keys.set(j, this->_digits[j]);
+    }
+
+    return std::pair(std::move(removed.found), orphan);
+  }
+
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::insert_at(uint index, Node<K, V, M> const& node) -> void {
+    if (this->_count == 5) {
+      throw std::out_of_range("no more than 5 nodes are permitted for digits");
+    }
+
+    for (uint i = this->_count; i > index; i--) {
+      this->_digits[i] = std::move(this->_digits[i - 1]);
+    }
+
+    this->_digits[index] = node;
+    this->_keys.insert(index, this->_count, node);
+    this->_count++;
+  }
+
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::erase_at(uint index) -> void {
+    for (uint i = index; i + 1 < this->_count; i++) {
+      this->_digits[i] = std::move(this->_digits[i + 1]);
+    }
+
+    this->_keys.erase(index, this->_count);
+    this->_count--;
+    this->_digits[this->_count] = Node<K, V, M>();
   }
 
-  template<typename K, typename V>
-  auto DigitsBase<K, V>::show(std::ostream& os, uint indent) const -> std::ostream& {
+  template<typename K, typename V, typename M>
+  auto DigitsBase<K, V, M>::show(std::ostream& os, uint indent) const -> std::ostream& {
     auto istr = std::string(indent * 2, ' ');
     auto istr2 = std::string((indent + 1) * 2, ' ');
 
     os << "[" << std::endl;
-    for (const auto& digit : this->_digits) {
+    for (const auto& digit : this->digits()) {
       os << istr2;
       digit.show(os, indent + 1);
       os << std::endl;
@@ -214,8 +352,8 @@ namespace collections::finger_tree::digit {
     return os;
   }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, DigitsBase<K, V> const& node) {
+  template<typename K, typename V, typename M>
+  std::ostream& operator<<(std::ostream& os, DigitsBase<K, V, M> const& node) {
     return node.show(os, 0);
   }
 }
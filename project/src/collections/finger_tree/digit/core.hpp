@@ -3,6 +3,6 @@
 // forward delarations
 
 namespace collections::finger_tree::digit {
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class Digits;
 }
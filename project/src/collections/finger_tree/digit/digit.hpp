@@ -1,58 +1,70 @@
 #pragma once
 
-#include "src/utils/uninit_exception.hpp"
-
 #include "src/collections/finger_tree/digit/base.hpp"
 #include "src/collections/finger_tree/digit/core.hpp"
 #include "src/collections/finger_tree/digit/_prelude.hpp"
 
+#include <algorithm>
 #include <iostream>
-#include <memory>
 #include <optional>
 #include <span>
 #include <stdexcept>
 #include <sys/types.h>
 
 namespace collections::finger_tree::digit {
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class Digits {
     // constructors
     public:
       Digits();
 
       // create various digits depending on the number of nodes inside them
-      Digits(Node<K, V> const& a);
-      Digits(Node<K, V> const& a, Node<K, V> const& b);
-      Digits(Node<K, V> const& a, Node<K, V> const& b, Node<K, V> const& c);
+      Digits(Node<K, V, M> const& a);
+      Digits(Node<K, V, M> const& a, Node<K, V, M> const& b);
+      Digits(Node<K, V, M> const& a, Node<K, V, M> const& b, Node<K, V, M> const& c);
       Digits(
-        Node<K, V> const& a,
-        Node<K, V> const& b,
-        Node<K, V> const& c,
-        Node<K, V> const& d
+        Node<K, V, M> const& a,
+        Node<K, V, M> const& b,
+        Node<K, V, M> const& c,
+        Node<K, V, M> const& d
       );
 
     public:
       // creates digits from the given nodes, throwing an exception if there
       // aren't enough to too many
-      static auto from_nodes(std::span<Node<K, V> const> nodes) -> Digits<K, V>;
+      static auto from_nodes(std::span<Node<K, V, M> const> nodes) -> Digits<K, V, M>;
 
     // accessors
     public:
       auto size() const -> uint;
       auto digit_size() const -> uint;
       auto key() const -> K const&;
-      auto digits() const -> std::span<Node<K, V> const>;
-      auto left() const -> Node<K, V> const&;
-      auto right() const -> Node<K, V> const&;
+
+      // return the measure of all nodes in these digits, this is not cached
+      // as there are at most five nodes to combine
+      auto measure() const -> typename M::Type;
+      auto digits() const -> std::span<Node<K, V, M> const>;
+      auto left() const -> Node<K, V, M> const&;
+      auto right() const -> Node<K, V, M> const&;
 
     // methods
     public:
       // return a pointer to the value this key refers to, or a nullptr if the
       // key didn't exist
-      auto get(K const& key) const -> V const*;
+      template<typename Q>
+      auto get(Q const& key) const -> V const*;
+
+      // return the key value pair at the given index, the index must be less
+      // than the size of these digits
+      auto at(uint index) const -> std::pair<K const&, V const&>;
+
+      // return the number of keys in these digits which are less than the
+      // given key
+      template<typename Q>
+      auto rank(Q const& key) const -> uint;
 
       // add a node at the given side
-      auto push(Direction dir, Node<K, V> const& node) -> void;
+      auto push(Direction dir, Node<K, V, M> const& node) -> void;
 
       // pop a node from the given side
       // undefined behavior if called on empty digits
@@ -60,76 +72,99 @@ namespace collections::finger_tree::digit {
 
       // unpack a deep node and add its children
       // this is used for underflow
-      auto unpack(Direction dir, NodeDeep<K, V> const& node) -> void;
+      auto unpack(Direction dir, NodeDeep<K, V, M> const& node) -> void;
 
       // pack nodes from the given side and return them
       // this is used for overflow
       // undefined behavior if called on less than 3 digits
-      auto pack(Direction dir) -> NodeDeep<K, V>;
+      auto pack(Direction dir) -> Node<K, V, M>;
+
+      // insert the given leaf into the node the key would be found in and
+      // return the old value if the key existed
+      //
+      // if that node overflows, its new sibling is added next to it, which
+      // may leave these digits with five nodes
+      auto insert(K const& key, Node<K, V, M> const& leaf) -> std::optional<V>;
+
+      // remove the leaf with the given key and return its value if it existed
+      //
+      // if a node is dissolved and has no sibling in these digits, its
+      // remaining child is returned alongside the value, which leaves these
+      // digits empty
+      auto remove(K const& key) -> std::pair<std::optional<V>, std::optional<Node<K, V, M>>>;
 
       // split the digit similar to a finger tree, but only do a shallow split
       //
       // because this may return empty spans and is used to create new trees,
       // the deep_smart construtor helper is needed for finger trees
-      auto split(K const& key) const -> std::tuple<
-        std::span<Node<K, V> const>,
-        std::optional<Node<K, V>>,
-        std::span<Node<K, V> const>
+      template<typename Q>
+      auto split(Q const& key) const -> std::tuple<
+        std::span<Node<K, V, M> const>,
+        std::optional<Node<K, V, M>>,
+        std::span<Node<K, V, M> const>
       >;
 
-    // helpers
-    public:
-      auto is_uninit() const -> bool { return this->_repr == nullptr; }
-
-      // ensure we're initalized (not nullptr)
-      auto assert_init() const -> void;
+      // split the digits at the child containing the key value pair at the given
+      // index, the index must be less than the size of this digits
+      auto split_at(uint index) const -> std::tuple<
+        std::span<Node<K, V, M> const>,
+        std::optional<Node<K, V, M>>,
+        std::span<Node<K, V, M> const>
+      >;
 
-      // ensure we're operating on a _repr instance which has no other
-      // referents
-      //
-      // the invisible persistnce section explains why this is tricky, hence why
-      // this currently always defensively copies the inner instance (not the
-      // shared ptr, but the inner variant object itself)
-      auto ensure_unique() -> void;
+      // split the digits at the first child at which the given predicate becomes
+      // true for the measure accumulated from the left, starting at acc, see
+      // FingerTree::split_by
+      template<typename P>
+      auto split_by(P const& pred, typename M::Type const& acc) const -> std::tuple<
+        std::span<Node<K, V, M> const>,
+        std::optional<Node<K, V, M>>,
+        std::span<Node<K, V, M> const>
+      >;
 
+    // helpers
+    public:
       // print a debug representation of the digits with the given indent
       auto show(std::ostream& os, uint indent) const -> std::ostream&;
 
     private:
-      std::shared_ptr<DigitsBase<K, V>> _repr;
+      // the digits are stored inline, they are small enough that copying them
+      // is cheaper than sharing them, so they are never shared and can always
+      // be modified in place
+      DigitsBase<K, V, M> _repr;
   };
 
-  template<typename K, typename V>
-  Digits<K, V>::Digits() : _repr(std::make_shared<DigitsBase<K, V>>()) {}
-
-  template<typename K, typename V>
-  Digits<K, V>::Digits(
-    Node<K, V> const& a
-  ) : _repr(std::make_shared<DigitsBase<K, V>>(a)) {}
-
-  template<typename K, typename V>
-  Digits<K, V>::Digits(
-    Node<K, V> const& a,
-    Node<K, V> const& b
-  ) : _repr(std::make_shared<DigitsBase<K, V>>(a, b)) {}
-
-  template<typename K, typename V>
-  Digits<K, V>::Digits(
-    Node<K, V> const& a,
-    Node<K, V> const& b,
-    Node<K, V> const& c
-  ) : _repr(std::make_shared<DigitsBase<K, V>>(a, b, c)) {}
-
-  template<typename K, typename V>
-  Digits<K, V>::Digits(
-    Node<K, V> const& a,
-    Node<K, V> const& b,
-    Node<K, V> const& c,
-    Node<K, V> const& d
-  ) : _repr(std::make_shared<DigitsBase<K, V>>(a, b, c, d)) {}
-
-  template<typename K, typename V>
-  auto Digits<K, V>::from_nodes(std::span<Node<K, V> const> nodes) -> Digits<K, V> {
+  template<typename K, typename V, typename M>
+  Digits<K, V, M>::Digits() : _repr() {}
+
+  template<typename K, typename V, typename M>
+  Digits<K, V, M>::Digits(
+    Node<K, V, M> const& a
+  ) : _repr(a) {}
+
+  template<typename K, typename V, typename M>
+  Digits<K, V, M>::Digits(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b
+  ) : _repr(a, b) {}
+
+  template<typename K, typename V, typename M>
+  Digits<K, V, M>::Digits(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b,
+    Node<K, V, M> const& c
+  ) : _repr(a, b, c) {}
+
+  template<typename K, typename V, typename M>
+  Digits<K, V, M>::Digits(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b,
+    Node<K, V, M> const& c,
+    Node<K, V, M> const& d
+  ) : _repr(a, b, c, d) {}
+
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::from_nodes(std::span<Node<K, V, M> const> nodes) -> Digits<K, V, M> {
     switch (nodes.size()) {
       case 0:
         // NOTE: this is technically not allowed but only serves as an
@@ -148,128 +183,206 @@ namespace collections::finger_tree::digit {
     }
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::size() const -> uint {
-    this->assert_init();
-    return this->_repr->size();
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::size() const -> uint {
+    return this->_repr.size();
+  }
+
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::digit_size() const -> uint {
+    return this->_repr.digit_size();
+  }
+
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::key() const -> K const& {
+    return this->_repr.key();
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::digit_size() const -> uint {
-    this->assert_init();
-    return this->_repr->digit_size();
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::measure() const -> typename M::Type {
+    auto measure = M::identity();
+    for (const auto& digit : this->digits()) {
+      measure = M::combine(measure, digit.measure());
+    }
+
+    return measure;
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::key() const -> K const& {
-    this->assert_init();
-    return this->_repr->key();
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto Digits<K, V, M>::get(Q const& key) const -> V const* {
+    return this->_repr.get(key);
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::get(K const& key) const -> V const* {
-    this->assert_init();
-    return this->_repr->get(key);
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::at(uint index) const -> std::pair<K const&, V const&> {
+    for (const auto& digit : this->digits()) {
+      if (index < digit.size()) {
+        return digit.at(index);
+      }
+
+      index -= digit.size();
+    }
+
+    throw std::out_of_range("index out of range for digits");
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto Digits<K, V, M>::rank(Q const& key) const -> uint {
+    auto digits = this->digits();
+
+    // NOTE: keys greater than the key of these digits are counted by the
+    // last node
+    uint rank = 0;
+    uint i = std::min<uint>(this->_repr.find(key), digits.size() - 1);
+    for (uint j = 0; j < i; j++) {
+      rank += digits[j].size();
+    }
+
+    return rank + digits[i].rank(key);
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::digits() const -> std::span<Node<K, V> const> {
-    this->assert_init();
-    return this->_repr->digits();
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::digits() const -> std::span<Node<K, V, M> const> {
+    return this->_repr.digits();
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::left() const -> Node<K, V> const& {
-    this->assert_init();
-    return this->_repr->left();
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::left() const -> Node<K, V, M> const& {
+    return this->_repr.left();
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::right() const -> Node<K, V> const& {
-    this->assert_init();
-    return this->_repr->right();
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::right() const -> Node<K, V, M> const& {
+    return this->_repr.right();
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::push(Direction dir, Node<K, V> const& node) -> void {
-    this->ensure_unique();
-    return this->_repr->push(dir, node);
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::push(Direction dir, Node<K, V, M> const& node) -> void {
+    return this->_repr.push(dir, node);
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::pop(Direction dir) -> void {
-    this->ensure_unique();
-    this->_repr->pop(dir);
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::pop(Direction dir) -> void {
+    this->_repr.pop(dir);
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::unpack(Direction dir, NodeDeep<K, V> const& node) -> void {
-    this->ensure_unique();
-    return this->_repr->unpack(dir, node);
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::unpack(Direction dir, NodeDeep<K, V, M> const& node) -> void {
+    return this->_repr.unpack(dir, node);
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::pack(Direction dir) -> NodeDeep<K, V> {
-    this->ensure_unique();
-    return this->_repr->pack(dir);
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::pack(Direction dir) -> Node<K, V, M> {
+    return this->_repr.pack(dir);
   }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::split(K const& key) const -> std::tuple<
-    std::span<Node<K, V> const>,
-    std::optional<Node<K, V>>,
-    std::span<Node<K, V> const>
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::insert(
+    K const& key,
+    Node<K, V, M> const& leaf
+  ) -> std::optional<V> {
+    return this->_repr.insert(key, leaf);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::remove(
+    K const& key
+  ) -> std::pair<std::optional<V>, std::optional<Node<K, V, M>>> {
+    return this->_repr.remove(key);
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto Digits<K, V, M>::split(Q const& key) const -> std::tuple<
+    std::span<Node<K, V, M> const>,
+    std::optional<Node<K, V, M>>,
+    std::span<Node<K, V, M> const>
   > {
-    std::span<Node<K, V> const> nodes = this->digits();
+    std::span<Node<K, V, M> const> nodes = this->digits();
+
+    uint i = this->_repr.find(key);
+    if (i == nodes.size()) {
+      return std::tuple(
+        nodes,
+        std::optional<Node<K, V, M>>(),
+        std::span<Node<K, V, M> const>()
+      );
+    }
+
+    return std::tuple(
+      nodes.subspan(0, i),
+      std::optional(nodes[i]),
+      nodes.subspan(i + 1)
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::split_at(uint index) const -> std::tuple<
+    std::span<Node<K, V, M> const>,
+    std::optional<Node<K, V, M>>,
+    std::span<Node<K, V, M> const>
+  > {
+    std::span<Node<K, V, M> const> nodes = this->digits();
 
     for (uint i = 0; i < nodes.size(); i++) {
-      if (nodes[i].key() >= key) {
+      if (index < nodes[i].size()) {
         return std::tuple(
           nodes.subspan(0, i),
           std::optional(nodes[i]),
           nodes.subspan(i + 1)
         );
       }
+
+      index -= nodes[i].size();
     }
 
     return std::tuple(
       nodes,
-      std::optional<Node<K, V>>(),
-      std::span<Node<K, V> const>()
+      std::optional<Node<K, V, M>>(),
+      std::span<Node<K, V, M> const>()
     );
   }
- 
-  template<typename K, typename V>
-  auto Digits<K, V>::assert_init() const -> void {
-    if (this->is_uninit()) {
-      throw UninitException("Digits are uninitialized");
-    }
-  }
 
-  template<typename K, typename V>
-  auto Digits<K, V>::ensure_unique() -> void {
-    this->assert_init();
-    // NOTE: no pointers or references to a Digits my be sent to another thread,
-    // only values of Digits, therefor no copy may be done between this check
-    // and subsequent writes
-    // if (this->_repr.use_count() == 1) {
-    //   return;
-    // }
-
-    this->_repr = std::make_shared<DigitsBase<K, V>>(*this->_repr);
-  }
+  template<typename K, typename V, typename M>
+  template<typename P>
+  auto Digits<K, V, M>::split_by(
+    P const& pred,
+    typename M::Type const& acc
+  ) const -> std::tuple<
+    std::span<Node<K, V, M> const>,
+    std::optional<Node<K, V, M>>,
+    std::span<Node<K, V, M> const>
+  > {
+    std::span<Node<K, V, M> const> nodes = this->digits();
 
-  template<typename K, typename V>
-  auto Digits<K, V>::show(std::ostream& os, uint indent) const -> std::ostream& {
-    if (this->_repr == nullptr) {
-      return os << "null";
+    auto current = acc;
+    for (uint i = 0; i < nodes.size(); i++) {
+      current = M::combine(current, nodes[i].measure());
+      if (pred(current)) {
+        return std::tuple(
+          nodes.subspan(0, i),
+          std::optional(nodes[i]),
+          nodes.subspan(i + 1)
+        );
+      }
     }
 
-    return this->_repr->show(os, indent);
+    return std::tuple(
+      nodes,
+      std::optional<Node<K, V, M>>(),
+      std::span<Node<K, V, M> const>()
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto Digits<K, V, M>::show(std::ostream& os, uint indent) const -> std::ostream& {
+    return this->_repr.show(os, indent);
   }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, Node<K, V> const& node) {
+  template<typename K, typename V, typename M>
+  std::ostream& operator<<(std::ostream& os, Node<K, V, M> const& node) {
     return node.show(os, 0);
   }
 }
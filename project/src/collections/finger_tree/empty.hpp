@@ -9,8 +9,8 @@
 #include <sys/types.h>
 
 namespace collections::finger_tree {
-  template<typename K, typename V>
-  class FingerTreeEmpty : public FingerTreeBase<K, V> {
+  template<typename K, typename V, typename M>
+  class FingerTreeEmpty : public FingerTreeBase<K, V, M> {
     // constructors
     public:
       FingerTreeEmpty() = default;
@@ -18,20 +18,20 @@ namespace collections::finger_tree {
     // helpers
     protected:
       // print a debug representation of the tree with the given indent
-      virtual auto show(std::ostream& os, uint indent) const -> std::ostream& override;
+      auto show(std::ostream& os, uint indent) const -> std::ostream&;
 
     private:
       // for completeness lol
-      friend class FingerTree<K, V>;
+      friend class FingerTree<K, V, M>;
   };
 
-  template<typename K, typename V>
-  auto FingerTreeEmpty<K, V>::show(std::ostream& os, uint) const -> std::ostream& {
+  template<typename K, typename V, typename M>
+  auto FingerTreeEmpty<K, V, M>::show(std::ostream& os, uint) const -> std::ostream& {
     return os << "Empty";
   }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, FingerTreeEmpty<K, V> const& tree) {
+  template<typename K, typename V, typename M>
+  std::ostream& operator<<(std::ostream& os, FingerTreeEmpty<K, V, M> const& tree) {
     return tree.show(os, 0);
   }
 }
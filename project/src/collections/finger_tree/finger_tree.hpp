@@ -20,6 +20,11 @@
 //   persistence, was also used for the other types, even if they did not
 //   strictly need it
 
+#include "src/utils/reclaimer.hpp"
+#include "src/utils/scratch_arena.hpp"
+#include "src/utils/slab_pool.hpp"
+#include "src/utils/tagged_ptr.hpp"
+#include "src/utils/thread_pool.hpp"
 #include "src/utils/uninit_exception.hpp"
 
 #include "src/collections/finger_tree/_prelude.hpp"
@@ -29,6 +34,10 @@
 #include "src/collections/finger_tree/empty.hpp"
 #include "src/collections/finger_tree/single.hpp"
 #include "src/collections/finger_tree/deep.hpp"
+#include "src/collections/finger_tree/suspension.hpp"
+#include "src/collections/finger_tree/transient.hpp"
+#include "src/collections/finger_tree/iterator.hpp"
+#include "src/collections/finger_tree/concurrent.hpp"
 
 #include "src/collections/finger_tree/digit/base.hpp"
 #include "src/collections/finger_tree/digit/digit.hpp"
@@ -36,66 +45,219 @@
 #include "src/collections/finger_tree/node/node.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <optional>
 #include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
 namespace collections::finger_tree {
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class FingerTree {
+    public:
+      using iterator = Iterator<K, V, M>;
+      using const_iterator = Iterator<K, V, M>;
+
+      // the comparator keys are ordered by, see measure.hpp
+      using key_compare = typename measure::CompareOf<K, M>::Type;
+
     // constructors
     public:
       FingerTree();
 
       // construct a finger tree with the given variant
-      FingerTree(FingerTreeEmpty<K, V> const& empty);
-      FingerTree(FingerTreeSingle<K, V> const& single);
-      FingerTree(FingerTreeDeep<K, V> const& deep);
+      FingerTree(FingerTreeEmpty<K, V, M> const& empty);
+      FingerTree(FingerTreeSingle<K, V, M> const& single);
+      FingerTree(FingerTreeDeep<K, V, M> const& deep);
+
+      FingerTree(FingerTree<K, V, M> const& other);
+      FingerTree(FingerTree<K, V, M>&& other);
+      ~FingerTree();
+
+      auto operator=(FingerTree<K, V, M> const& other) -> FingerTree<K, V, M>&;
+      auto operator=(FingerTree<K, V, M>&& other) -> FingerTree<K, V, M>&;
+
+      // construct a finger tree from the given key value pairs in O(n), the
+      // keys must be sorted in ascending order and unique, this is only
+      // checked in debug builds
+      static auto from_sorted(std::span<std::pair<K, V> const> pairs) -> FingerTree<K, V, M>;
+
+      template<typename I>
+      static auto from_sorted(I first, I last) -> FingerTree<K, V, M>;
+
+      // like from_sorted, but large inputs are split into chunks which are
+      // built on the shared thread pool and concatenated, this is O(n) work
+      // and O(log(n)^2) span, thread local trees can't use this
+      static auto from_sorted_parallel(
+        std::span<std::pair<K, V> const> pairs
+      ) -> FingerTree<K, V, M>;
 
     private:
       // construct a finger tree from the given nodes at this layer
-      // this is a shorthand for appending to an empty finger tree
-      static auto from_nodes(std::span<Node<K, V> const> nodes) -> FingerTree<K, V>;
+      //
+      // the tree is built bottom up, the outer nodes become the digits and
+      // the inner ones are packed into the nodes of the middle tree
+      static auto from_nodes(std::span<Node<K, V, M> const> nodes) -> FingerTree<K, V, M>;
 
       // create a new deep finger tree with the given fields, but ensure that
       // the digits are not empty by underflowing from the middle tree
       // this is necessary for various intermediate states in split or concat
       static auto deep_smart(
-        std::span<Node<K, V> const> left,
-        FingerTree<K, V> const& middle,
-        std::span<Node<K, V> const> right
-      ) -> FingerTree<K, V>;
+        std::span<Node<K, V, M> const> left,
+        Suspension<K, V, M> const& middle,
+        std::span<Node<K, V, M> const> right
+      ) -> FingerTree<K, V, M>;
+
+      // like deep_smart, but either side may have more nodes than fit into
+      // digits, those further in are packed and concatenated to the middle
+      // tree
+      static auto deep_packed(
+        std::span<Node<K, V, M> const> left,
+        Suspension<K, V, M> const& middle,
+        std::span<Node<K, V, M> const> right
+      ) -> FingerTree<K, V, M>;
 
     // accessors
     public:
       // return the number of key value pairs in this tree
       auto size() const -> uint;
 
+      // return the measure of all key value pairs in this tree, see
+      // measure.hpp
+      auto measure() const -> typename M::Type;
+
     // methods
     public:
       // return the value that this key points to, or nullptr if this key
       // doesn't eixst
-      auto get(K const& key) const -> V const*;
+      //
+      // this and the other lookup functions also accept any key type the
+      // comparator can compare with if it is transparent, see
+      // src/utils/compare.hpp
+      auto get(K const& key) const -> V const* { return this->template get<K>(key); }
+
+      template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+      auto get(Q const& key) const -> V const*;
+
+      // return the key value pair at the given index in key order, throwing
+      // an exception if the index is out of range, this is also known as
+      // select
+      //
+      // the returned references are invalidated by any modification of this
+      // tree
+      auto at(uint index) const -> std::pair<K const&, V const&>;
+
+      // return the number of keys in this tree which are less than the given
+      // key, this is the index the key is found or would be inserted at
+      auto rank(K const& key) const -> uint { return this->template rank<K>(key); }
+
+      template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+      auto rank(Q const& key) const -> uint;
 
       // push a key value pair to the given side
       // this is public for demonstration purposes and should not actually be
       // exposed as the key ordering constraint can easily be broken
       auto push(Direction dir, K const& key, V const& val) -> void;
+      auto push(Direction dir, K&& key, V&& val) -> void;
 
-      // pop a key value pair from the given side
+      // pop a key value pair from the given side, it is moved out of the tree
+      // if no other tree shares its leaf
       auto pop(Direction dir) -> std::optional<std::pair<K, V>>;
 
       // insert a key value pair into the tree
       // if this key already existed in the tree its old value is returned and
-      // swaped with the given parameter
+      // swaped with the given parameter, the old value is moved out of the
+      // tree if no other tree shares its leaf
       auto insert(K const& key, V const& val) -> std::optional<V>;
+      auto insert(K&& key, V&& val) -> std::optional<V>;
+
+      // like insert, but the value is constructed in place from the given
+      // arguments, this also covers moving only one of key or value
+      template<typename... Args>
+      auto emplace(K key, Args&&... args) -> std::optional<V>;
 
       // remove a key value pair from the tree and retunr it's value if it
       // existed
       auto remove(K const& key) -> std::optional<V>;
 
+      // insert all given key value pairs into the tree and return the number
+      // of keys which didn't exist before, for keys given more than once the
+      // last value is kept
+      //
+      // the batch is sorted once and applied in one descent, the leaves are
+      // split into runs by the digits and nodes they would be found in, so
+      // every node on their paths is copied once for its whole run and
+      // untouched nodes are shared, no key is inserted by a split and concat
+      auto insert_batch(std::span<std::pair<K, V> const> pairs) -> uint;
+
+      // remove all given keys from the tree and return the number of keys
+      // which existed, see insert_batch
+      auto remove_batch(std::span<K const> keys) -> uint;
+
+      // create a transient from this tree for batched modification, this
+      // tree is not modified by it
+      auto transient() const -> Transient<K, V, M>;
+
+      // fold the key value pairs of this tree in key order
+      //
+      // the tree is divided into chunks of roughly equal size by the cached
+      // sizes, each chunk is folded by func starting at init on the shared
+      // thread pool and the results of adjacent chunks are combined in key
+      // order, so init must be an identity of combine, thread local trees
+      // can't use this
+      //
+      //   func(T acc, K const& key, V const& val) -> T
+      //   combine(T const& left, T const& right) -> T
+      template<typename T, typename F, typename C>
+      auto parallel_reduce(T const& init, F const& func, C const& combine) const -> T;
+
+      // call func with every key value pair of this tree, the chunks of
+      // parallel_reduce are processed concurrently, so func must be safe to
+      // call from multiple threads
+      template<typename F>
+      auto parallel_for_each(F const& func) const -> void;
+
+      // return iterators over the key value pairs of this tree in key order,
+      // these are invalidated by any modification of this tree
+      auto begin() const -> Iterator<K, V, M>;
+      auto end() const -> Iterator<K, V, M>;
+
+      // return an iterator at the first key value pair whose key is not less
+      // than/greater than the given key
+      auto lower_bound(K const& key) const -> Iterator<K, V, M> {
+        return this->template lower_bound<K>(key);
+      }
+      auto upper_bound(K const& key) const -> Iterator<K, V, M> {
+        return this->template upper_bound<K>(key);
+      }
+
+      template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+      auto lower_bound(Q const& key) const -> Iterator<K, V, M>;
+      template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+      auto upper_bound(Q const& key) const -> Iterator<K, V, M>;
+
+      // return the range of key value pairs with the given key, this contains
+      // at most one element
+      auto equal_range(K const& key) const -> std::pair<Iterator<K, V, M>, Iterator<K, V, M>> {
+        return this->template equal_range<K>(key);
+      }
+
+      template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+      auto equal_range(Q const& key) const -> std::pair<Iterator<K, V, M>, Iterator<K, V, M>>;
+
+      // the naive definitions of insert and remove by splitting the tree and
+      // concatenating the results, these are only kept for comparison in the
+      // benchmarks
+      auto insert_by_split(K const& key, V const& val) -> std::optional<V>;
+      auto remove_by_split(K const& key) -> std::optional<V>;
+
       // split this tree at the given key
       // returning a left anr right tree, as well as the value if this key
       // existed
@@ -103,26 +265,136 @@ namespace collections::finger_tree {
       // less than/greater than the given parameter respectively
       auto split(
         K const& key
-      ) const -> std::tuple<FingerTree<K, V>, std::optional<V>, FingerTree<K, V>>;
+      ) const& -> std::tuple<FingerTree<K, V, M>, std::optional<V>, FingerTree<K, V, M>> {
+        return this->template split<K>(key);
+      }
+
+      template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+      auto split(
+        Q const& key
+      ) const& -> std::tuple<FingerTree<K, V, M>, std::optional<V>, FingerTree<K, V, M>>;
+
+      // like split, but this tree is consumed, nodes which were only referred
+      // to by it are uniquely owned by the returned trees afterwards, so they
+      // are modified in place by later operations, and the value is moved out
+      auto split(
+        K const& key
+      ) && -> std::tuple<FingerTree<K, V, M>, std::optional<V>, FingerTree<K, V, M>>;
+
+      // return a tree of all key value pairs whose keys are not less than lo
+      // and less than hi
+      auto slice(K const& lo, K const& hi) const -> FingerTree<K, V, M>;
+
+      // remove all key value pairs whose keys are not less than lo and less
+      // than hi and return how many were removed
+      //
+      // this splits the tree twice and concatenates the outer trees, so it
+      // does not depend on the number of removed key value pairs
+      auto erase_range(K const& lo, K const& hi) -> uint;
+
+      // split this tree at the given index
+      // returning a left and right tree, the left tree contains the first
+      // index key value pairs and the right tree the remaining ones
+      auto split_at(uint index) const -> std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>>;
+
+      // return a tree of the first/all but the first count key value pairs
+      // of this tree
+      auto take(uint count) const -> FingerTree<K, V, M>;
+      auto drop(uint count) const -> FingerTree<K, V, M>;
+
+      // split this tree at the first key value pair at which the given
+      // predicate becomes true for the measure accumulated from the left
+      // returning a left and right tree, as well as that key value pair
+      //
+      // the predicate must be monotone, once it is true for some prefix it
+      // must be true for all longer prefixes, if it is not true for the whole
+      // tree, the whole tree is returned on the left
+      template<typename P>
+      auto split_by(P const& pred) const -> std::tuple<
+        FingerTree<K, V, M>,
+        std::optional<std::pair<K, V>>,
+        FingerTree<K, V, M>
+      >;
 
     private:
       // internal definition of push which cna be used recursively
-      auto push_node(Direction dir, Node<K, V> const& node) -> void;
+      auto push_node(Direction dir, Node<K, V, M> const& node) -> void;
 
       // internal definition of pop which cna be used recursively
-      auto pop_node(Direction dir) -> std::optional<Node<K, V>>;
+      auto pop_node(Direction dir) -> std::optional<Node<K, V, M>>;
 
-      // internal definition of append which can be used recursively
-      auto append_nodes(Direction dir, std::span<Node<K, V> const> nodes) -> void;
+      // return the node which would be popped from the given side
+      auto peek_node(Direction dir) const -> std::optional<Node<K, V, M>>;
 
-      // internal definition of take which can be used recursively
-      auto take_nodes(Direction dir, uint count) -> std::vector<Node<K, V>>;
+      // internal definition of append which can be used recursively
+      auto append_nodes(Direction dir, std::span<Node<K, V, M> const> nodes) -> void;
 
       // internal definition of split which can be used recursively
-      auto split_node(K const& key) const -> std::tuple<
-        FingerTree<K, V>,
-        std::optional<Node<K, V>>,
-        FingerTree<K, V>
+      template<typename Q>
+      auto split_node(Q const& key) const -> std::tuple<
+        FingerTree<K, V, M>,
+        std::optional<Node<K, V, M>>,
+        FingerTree<K, V, M>
+      >;
+
+      // split this tree into the key value pairs whose keys are less than the
+      // given key and the remaining ones
+      template<typename Q>
+      auto split_before(Q const& key) const -> std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>>;
+
+      // internal definition of split_at which can be used recursively, the
+      // returned node contains the key value pair at the given index, which
+      // must be less than the size of this tree
+      auto split_node_at(uint index) const -> std::tuple<
+        FingerTree<K, V, M>,
+        std::optional<Node<K, V, M>>,
+        FingerTree<K, V, M>
+      >;
+
+      // internal definition of split_by which can be used recursively, the
+      // predicate must be true for acc combined with the measure of this tree
+      template<typename P>
+      auto split_node_by(P const& pred, typename M::Type const& acc) const -> std::tuple<
+        FingerTree<K, V, M>,
+        std::optional<Node<K, V, M>>,
+        FingerTree<K, V, M>
+      >;
+
+      // internal definition of insert which can be used recursively, the leaf
+      // is inserted into the node which the key would be found in
+      auto insert_node(K const& key, Node<K, V, M> const& leaf) -> std::optional<V>;
+
+      // internal definition of remove which can be used recursively
+      //
+      // if a single tree's node is dissolved, the tree becomes empty and the
+      // remaining child of that node is returned alongside the removed value,
+      // it is one level less deep than this tree's nodes
+      auto remove_node(K const& key) -> std::pair<
+        std::optional<V>,
+        std::optional<Node<K, V, M>>
+      >;
+
+      // internal definition of insert_batch which can be used recursively, the
+      // leaves must be sorted by key with unique keys, return this tree with
+      // them inserted and the number of keys which didn't exist before
+      //
+      // this must be called inside a ScratchArena::Scope, see
+      // Node::insert_run
+      auto insert_leaves(
+        std::span<Node<K, V, M> const> leaves
+      ) const -> std::pair<FingerTree<K, V, M>, uint>;
+
+      // internal definition of remove_batch which can be used recursively, this
+      // tree's nodes are depth levels above their leaves, return this tree with
+      // the keys removed and the number of keys which existed
+      //
+      // if all that's left is a node less deep than this tree's nodes, the
+      // tree is empty and that node is returned alongside its depth, like the
+      // remaining child returned by remove_node
+      auto remove_keys(std::span<K const> keys, uint depth) const -> std::tuple<
+        FingerTree<K, V, M>,
+        uint,
+        std::optional<std::pair<Node<K, V, M>, uint>>
       >;
 
     // functions
@@ -130,17 +402,151 @@ namespace collections::finger_tree {
       // concat two trees
       // likewise to push, this is only public for demonstration purposes
       static auto concat(
-        FingerTree<K, V> const& left,
-        FingerTree<K, V> const& right
-      ) -> FingerTree<K, V>;
+        FingerTree<K, V, M> const& left,
+        FingerTree<K, V, M> const& right
+      ) -> FingerTree<K, V, M>;
+
+      // like concat, but both trees are consumed, the spine of the left tree
+      // and the middle trees of both are modified in place if nobody else
+      // refers to them
+      static auto concat(
+        FingerTree<K, V, M>&& left,
+        FingerTree<K, V, M>&& right
+      ) -> FingerTree<K, V, M>;
+
+      // return a tree of all key value pairs in either tree, the values of the
+      // left tree take precedence for keys in both trees
+      //
+      // these set operations split the larger tree by the keys of the smaller
+      // one and recurse on both halves, for m key value pairs in the smaller
+      // and n in the larger tree this is O(m log(n / m + 1)), with
+      // Execution::Parallel the halves of large inputs are processed on
+      // separate threads, unless the tree is thread local
+      static auto merge(
+        FingerTree<K, V, M> const& left,
+        FingerTree<K, V, M> const& right,
+        Execution exec = Execution::Sequential
+      ) -> FingerTree<K, V, M>;
+
+      // return a tree of all key value pairs of the left tree whose keys are
+      // in the right tree, see merge
+      static auto intersect(
+        FingerTree<K, V, M> const& left,
+        FingerTree<K, V, M> const& right,
+        Execution exec = Execution::Sequential
+      ) -> FingerTree<K, V, M>;
+
+      // return a tree of all key value pairs of the left tree whose keys are
+      // not in the right tree, see merge
+      static auto difference(
+        FingerTree<K, V, M> const& left,
+        FingerTree<K, V, M> const& right,
+        Execution exec = Execution::Sequential
+      ) -> FingerTree<K, V, M>;
+
+      // ensure the slab pool cache of the calling thread holds at least count
+      // blocks for each kind of node, tree variant and pending operation on a
+      // middle tree, that its scratch arena has a chunk and that it can defer
+      // destroying count nodes, operations inside a SlabPool::Realtime scope
+      // then allocate their nodes from these blocks without calling the
+      // global allocator, see src/utils/slab_pool.hpp
+      static auto reserve(uint count) -> void;
 
     private:
+      // whether this tree must stay on the thread it was created on
+      static constexpr bool IS_LOCAL = measure::ThreadPolicyOf<M>::Type::IS_LOCAL;
+
+      // below this size parallel operations don't hand off any more work to
+      // the thread pool
+      static constexpr uint PARALLEL_CUTOFF = 1 << 14;
+
+      // below this size of the smaller tree the set operations update or
+      // query the larger tree per key instead of splitting it further, which
+      // has much smaller constant factors
+      static constexpr uint SET_CUTOFF = 64;
+
+      // the internal definitions of the set operations, halves are only
+      // processed in parallel for the given number of recursion levels
+      static auto merge_inner(
+        FingerTree<K, V, M> const& left,
+        FingerTree<K, V, M> const& right,
+        uint spawn
+      ) -> FingerTree<K, V, M>;
+
+      static auto intersect_inner(
+        FingerTree<K, V, M> const& left,
+        FingerTree<K, V, M> const& right,
+        uint spawn
+      ) -> FingerTree<K, V, M>;
+
+      static auto difference_inner(
+        FingerTree<K, V, M> const& left,
+        FingerTree<K, V, M> const& right,
+        uint spawn
+      ) -> FingerTree<K, V, M>;
+
+      // split the smaller of the given trees at its middle key value pair and
+      // the larger one at that pair's key, returning the left halves, the
+      // pivot and whether it came from the left tree, the value of the
+      // larger tree for the pivot key if it had one and the right halves
+      static auto split_pivot(
+        FingerTree<K, V, M> const& left,
+        FingerTree<K, V, M> const& right
+      ) -> std::tuple<
+        std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>>,
+        std::pair<Node<K, V, M>, bool>,
+        std::optional<V>,
+        std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>>
+      >;
+
+      // apply the given function to both pairs of halves, on separate threads
+      // if spawn is not zero
+      template<typename F>
+      static auto fork(
+        uint spawn,
+        F const& func,
+        std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>> const& left,
+        std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>> const& right
+      ) -> std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>>;
+
+      // return the number of recursion levels which are processed in parallel
+      // for the given execution and input size
+      static auto spawn_levels(Execution exec, uint size) -> uint;
+
+      // internal definition of parallel_reduce over the given index range
+      template<typename T, typename F, typename C>
+      auto reduce_range(
+        uint first,
+        uint last,
+        T const& init,
+        F const& func,
+        C const& combine
+      ) const -> T;
+
       // internal definition of concat which can be used recursively
       static auto concat_inner(
-        FingerTree<K, V> const& left,
-        std::vector<Node<K, V>> const& middle,
-        FingerTree<K, V> const& right
-      ) -> FingerTree<K, V>;
+        FingerTree<K, V, M> const& left,
+        std::span<Node<K, V, M> const> middle,
+        FingerTree<K, V, M> const& right
+      ) -> FingerTree<K, V, M>;
+
+      static auto concat_inner(
+        FingerTree<K, V, M>&& left,
+        std::span<Node<K, V, M> const> middle,
+        FingerTree<K, V, M>&& right
+      ) -> FingerTree<K, V, M>;
+
+      // take the middle tree of the given deep tree, moving it out if nobody
+      // else refers to the tree, which is left without a middle tree
+      static auto take_middle(FingerTree<K, V, M>& tree) -> FingerTree<K, V, M>;
+
+      // if the given digits contain five nodes, the three inner ones are
+      // packed and pushed onto the middle tree
+      static auto digits_overflow(
+        Direction dir,
+        Digits<K, V, M>& digits,
+        Suspension<K, V, M>& middle
+      ) -> void;
 
     // helpers
     public:
@@ -150,14 +556,18 @@ namespace collections::finger_tree {
       // C++'s horrible standard library, so I gave up and embraced the nullptr
       // default state
 
-      auto is_uninit() const -> bool { return this->_repr == nullptr; }
-      auto is_empty() const -> bool { return this->_kind == Kind::Empty; }
-      auto is_single() const -> bool { return this->_kind == Kind::Single; }
-      auto is_deep() const -> bool { return this->_kind == Kind::Deep; }
+      auto is_uninit() const -> bool { return this->_repr.is_null(); }
+      auto is_empty() const -> bool { return this->_repr.tag() == FingerTree<K, V, M>::tag(Kind::Empty); }
+      auto is_single() const -> bool { return this->_repr.tag() == FingerTree<K, V, M>::tag(Kind::Single); }
+      auto is_deep() const -> bool { return this->_repr.tag() == FingerTree<K, V, M>::tag(Kind::Deep); }
+
+      auto as_empty() const -> FingerTreeEmpty<K, V, M> const& {
+        // NOTE: the empty variant is never allocated, it has no state so all
+        // empty trees can share this one
+        static FingerTreeEmpty<K, V, M> const empty;
 
-      auto as_empty() const -> FingerTreeEmpty<K, V> const& {
         if (this->is_empty()) {
-          return *static_cast<FingerTreeEmpty<K, V> const*>(this->_repr.get());
+          return empty;
         } else {
           if (this->is_single()) {
             throw VariantException("Attmpted to get Empty reference to Single");
@@ -167,9 +577,9 @@ namespace collections::finger_tree {
         }
       }
 
-      auto as_single() const -> FingerTreeSingle<K, V> const& {
+      auto as_single() const -> FingerTreeSingle<K, V, M> const& {
         if (this->is_single()) {
-          return *static_cast<FingerTreeSingle<K, V> const*>(this->_repr.get());
+          return *static_cast<FingerTreeSingle<K, V, M> const*>(this->_repr.ptr());
         } else {
           if (this->is_empty()) {
             throw VariantException("Attmpted to get Single reference to Empty");
@@ -179,9 +589,9 @@ namespace collections::finger_tree {
         }
       }
 
-      auto as_deep() const -> FingerTreeDeep<K, V> const& {
+      auto as_deep() const -> FingerTreeDeep<K, V, M> const& {
         if (this->is_deep()) {
-          return *static_cast<FingerTreeDeep<K, V> const*>(this->_repr.get());
+          return *static_cast<FingerTreeDeep<K, V, M> const*>(this->_repr.ptr());
         } else {
           if (this->is_empty()) {
             throw VariantException("Attmpted to get Deep reference to Empty");
@@ -191,104 +601,254 @@ namespace collections::finger_tree {
         }
       }
 
+      // mutable access to the single variant, must only be used after
+      // ensure_unique
+      auto as_single_mut() -> FingerTreeSingle<K, V, M>& {
+        return *static_cast<FingerTreeSingle<K, V, M>*>(this->_repr.ptr());
+      }
+
+      // mutable access to the deep variant, must only be used after
+      // ensure_unique
+      auto as_deep_mut() -> FingerTreeDeep<K, V, M>& {
+        return *static_cast<FingerTreeDeep<K, V, M>*>(this->_repr.ptr());
+      }
+
       // ensure we're initalized (not nullptr)
       auto assert_init() const -> void;
 
       // ensure we're operating on a _repr instance which has no other
-      // referents
+      // referents, the inner variant object is copied if it is shared and
+      // modified in place otherwise
       //
-      // the invisible persistnce section explains why this is tricky, hence why
-      // this currently always defensively copies the inner instance (not the
-      // shared ptr, but the inner variant object itself)
+      // the invisible persistence section explains why this is tricky, values
+      // of FingerTree may be sent to other threads, but a single FingerTree
+      // object must never be accessed by another thread while it is written
       auto ensure_unique() -> void;
 
       // set the repr field to the given variant
-      auto set(FingerTreeEmpty<K, V> empty) -> void;
-      auto set(FingerTreeSingle<K, V> single) -> void;
-      auto set(FingerTreeDeep<K, V> deep) -> void;
+      auto set(FingerTreeEmpty<K, V, M> empty) -> void;
+      auto set(FingerTreeSingle<K, V, M> single) -> void;
+      auto set(FingerTreeDeep<K, V, M> deep) -> void;
 
       // print a debug representation of the tree with the given indent
       auto show(std::ostream& os, uint indent) const -> std::ostream&;
 
     private:
-      Kind _kind;
-      std::shared_ptr<FingerTreeBase<K, V>> _repr;
+      // the pointer tag of each variant, zero is left for the uninitialized
+      // state
+      static constexpr auto tag(Kind kind) -> uint { return static_cast<uint>(kind) + 1; }
+
+      // add or drop a reference to the variant we point to, the last
+      // reference destroys it
+      auto acquire() const -> void;
+      auto release() -> void;
+
+    private:
+      // the single and deep variants are intrusively reference counted and the
+      // kind is stored in the pointer tag, the empty variant has no state and
+      // is therefore never allocated, it's only a tag
+      TaggedPtr<FingerTreeBase<K, V, M>> _repr;
+
+      // suspensions apply pending pushes and pops when forced
+      friend class Suspension<K, V, M>;
   };
 
-  template<typename K, typename V>
-  FingerTree<K, V>::FingerTree() : FingerTree<K, V>(FingerTreeEmpty<K, V>()) {}
-
-  template<typename K, typename V>
-  FingerTree<K, V>::FingerTree(
-    FingerTreeEmpty<K, V> const& empty
-  ) : _kind(Kind::Empty), _repr(std::static_pointer_cast<FingerTreeBase<K, V>>(
-    std::make_shared<FingerTreeEmpty<K, V>>(empty)
-  )) {}
-
-  template<typename K, typename V>
-  FingerTree<K, V>::FingerTree(
-    FingerTreeSingle<K, V> const& single
-  ) : _kind(Kind::Single), _repr(std::static_pointer_cast<FingerTreeBase<K, V>>(
-    std::make_shared<FingerTreeSingle<K, V>>(single)
-  )) {}
-
-  template<typename K, typename V>
-  FingerTree<K, V>::FingerTree(
-    FingerTreeDeep<K, V> const& deep
-  ) : _kind(Kind::Deep), _repr(std::static_pointer_cast<FingerTreeBase<K, V>>(
-    std::make_shared<FingerTreeDeep<K, V>>(deep)
-  )) {}
-
-  template<typename K, typename V>
-  auto FingerTree<K, V>::from_nodes(
-    std::span<Node<K, V> const> nodes
-  ) -> FingerTree<K, V> {
-    auto tree = FingerTree<K, V>();
-    tree.append_nodes(Direction::Right, nodes);
-    return tree;
+  template<typename K, typename V, typename M>
+  FingerTree<K, V, M>::FingerTree() : FingerTree<K, V, M>(FingerTreeEmpty<K, V, M>()) {}
+
+  template<typename K, typename V, typename M>
+  FingerTree<K, V, M>::FingerTree(
+    FingerTreeEmpty<K, V, M> const&
+  ) : _repr(nullptr, FingerTree<K, V, M>::tag(Kind::Empty)) {}
+
+  template<typename K, typename V, typename M>
+  FingerTree<K, V, M>::FingerTree(
+    FingerTreeSingle<K, V, M> const& single
+  ) : _repr(new FingerTreeSingle<K, V, M>(single), FingerTree<K, V, M>::tag(Kind::Single)) {}
+
+  template<typename K, typename V, typename M>
+  FingerTree<K, V, M>::FingerTree(
+    FingerTreeDeep<K, V, M> const& deep
+  ) : _repr(new FingerTreeDeep<K, V, M>(deep), FingerTree<K, V, M>::tag(Kind::Deep)) {}
+
+  template<typename K, typename V, typename M>
+  FingerTree<K, V, M>::FingerTree(FingerTree<K, V, M> const& other) : _repr(other._repr) {
+    this->acquire();
+  }
+
+  template<typename K, typename V, typename M>
+  FingerTree<K, V, M>::FingerTree(FingerTree<K, V, M>&& other) : _repr(other._repr) {
+    other._repr = TaggedPtr<FingerTreeBase<K, V, M>>();
+  }
+
+  template<typename K, typename V, typename M>
+  FingerTree<K, V, M>::~FingerTree() {
+    this->release();
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::operator=(
+    FingerTree<K, V, M> const& other
+  ) -> FingerTree<K, V, M>& {
+    // NOTE: acquire first, the other tree may be referred to by this one
+    other.acquire();
+    this->release();
+    this->_repr = other._repr;
+    return *this;
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::operator=(
+    FingerTree<K, V, M>&& other
+  ) -> FingerTree<K, V, M>& {
+    // NOTE: detach first, the other tree may be referred to by this one
+    auto repr = other._repr;
+    other._repr = TaggedPtr<FingerTreeBase<K, V, M>>();
+    this->release();
+    this->_repr = repr;
+    return *this;
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::from_sorted(
+    std::span<std::pair<K, V> const> pairs
+  ) -> FingerTree<K, V, M> {
+    return FingerTree<K, V, M>::from_sorted(pairs.begin(), pairs.end());
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename I>
+  auto FingerTree<K, V, M>::from_sorted(I first, I last) -> FingerTree<K, V, M> {
+    ScratchArena::Scope scope;
+
+    ScratchVector<Node<K, V, M>> leaves;
+    if constexpr (std::forward_iterator<I>) {
+      leaves.reserve(std::distance(first, last));
+    }
+
+    for (; first != last; first++) {
+      const auto& [key, val] = *first;
+      leaves.emplace_back(key, val);
+    }
+
+#ifndef NDEBUG
+    for (uint i = 1; i < leaves.size(); i++) {
+      if (measure::compare<K, M>(leaves[i - 1].key(), leaves[i].key()) >= 0) {
+        throw std::invalid_argument("keys must be sorted in ascending order and unique");
+      }
+    }
+#endif
+
+    return FingerTree<K, V, M>::from_nodes(leaves);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::from_nodes(
+    std::span<Node<K, V, M> const> nodes
+  ) -> FingerTree<K, V, M> {
+    if (nodes.size() == 0) {
+      return FingerTree<K, V, M>();
+    }
+
+    if (nodes.size() == 1) {
+      return FingerTree<K, V, M>(FingerTreeSingle<K, V, M>(nodes[0]));
+    }
+
+    // NOTE: up to eight nodes fit into the digits alone
+    if (nodes.size() <= 8) {
+      auto half = nodes.size() / 2;
+      return FingerTree<K, V, M>(FingerTreeDeep<K, V, M>(
+        Digits<K, V, M>::from_nodes(nodes.subspan(0, half)),
+        FingerTree<K, V, M>(),
+        Digits<K, V, M>::from_nodes(nodes.subspan(half))
+      ));
+    }
+
+    // leave three nodes on each side, so the middle tree gets at least three
+    // nodes to pack
+    ScratchArena::Scope scope;
+    auto packed = Node<K, V, M>::pack_nodes(nodes.subspan(3, nodes.size() - 6));
+    return FingerTree<K, V, M>(FingerTreeDeep<K, V, M>(
+      Digits<K, V, M>::from_nodes(nodes.subspan(0, 3)),
+      FingerTree<K, V, M>::from_nodes(packed),
+      Digits<K, V, M>::from_nodes(nodes.subspan(nodes.size() - 3))
+    ));
   }
 
   // this is the equivalent of the smart constructors mentioned in the haskell
   // paper called deep_L and deep_R, as a single constructor helper
   // it fills the left and right digits by poping from the middle tree
   //
-  // unlike the haskell usage of the deep constructors, this is not lazy with
-  // respect to underflow
-  template<typename K, typename V>
-  auto FingerTree<K, V>::deep_smart(
-    std::span<Node<K, V> const> left,
-    FingerTree<K, V> const& middle,
-    std::span<Node<K, V> const> right
-  ) -> FingerTree<K, V> {
-    Digits<K, V> left_copy = Digits<K, V>::from_nodes(left);
-    FingerTree<K, V> middle_copy = middle;
-    Digits<K, V> right_copy = Digits<K, V>::from_nodes(right);
+  // like the haskell usage of the deep constructors, this is only lazy with
+  // respect to underflow if FINGER_TREE_LAZY is defined, the node is taken
+  // from the middle tree immediately, but its removal is suspended
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::deep_smart(
+    std::span<Node<K, V, M> const> left,
+    Suspension<K, V, M> const& middle,
+    std::span<Node<K, V, M> const> right
+  ) -> FingerTree<K, V, M> {
+    Digits<K, V, M> left_copy = Digits<K, V, M>::from_nodes(left);
+    Suspension<K, V, M> middle_copy = middle;
+    Digits<K, V, M> right_copy = Digits<K, V, M>::from_nodes(right);
 
     if (left_copy.digit_size() == 0) {
       if (middle.is_empty()) {
-        return FingerTree<K, V>::from_nodes(right_copy.digits());
+        return FingerTree<K, V, M>::from_nodes(right_copy.digits());
       }
 
       // NOTE: middle cannot contain leaves and is not empty
-      Node<K, V> underflow = *middle_copy.pop_node(Direction::Left);
+      Node<K, V, M> underflow = *middle_copy.pop(Direction::Left);
       left_copy.unpack(Direction::Right, underflow.as_deep());
     }
 
     if (right_copy.digit_size() == 0) {
-      if (middle.is_empty()) {
-        return FingerTree<K, V>::from_nodes(left_copy.digits());
+      if (middle_copy.is_empty()) {
+        return FingerTree<K, V, M>::from_nodes(left_copy.digits());
       }
 
       // NOTE: middle cannot contain leaves and is not empty
-      Node<K, V> underflow = *middle_copy.pop_node(Direction::Right);
+      Node<K, V, M> underflow = *middle_copy.pop(Direction::Right);
       right_copy.unpack(Direction::Left, underflow.as_deep());
     }
 
-    return FingerTree(FingerTreeDeep<K, V>(left_copy, middle_copy, right_copy));
+    return FingerTree(FingerTreeDeep<K, V, M>(left_copy, middle_copy, right_copy));
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::deep_packed(
+    std::span<Node<K, V, M> const> left,
+    Suspension<K, V, M> const& middle,
+    std::span<Node<K, V, M> const> right
+  ) -> FingerTree<K, V, M> {
+    Suspension<K, V, M> middle_copy = middle;
+
+    // NOTE: three nodes are kept in the digits, so at least two are packed
+    if (left.size() > 4) {
+      ScratchArena::Scope scope;
+      auto packed = Node<K, V, M>::pack_nodes(left.subspan(3));
+      middle_copy = FingerTree<K, V, M>::concat(
+        FingerTree<K, V, M>::from_nodes(packed),
+        middle_copy.force()
+      );
+      left = left.subspan(0, 3);
+    }
+
+    if (right.size() > 4) {
+      ScratchArena::Scope scope;
+      auto packed = Node<K, V, M>::pack_nodes(right.subspan(0, right.size() - 3));
+      middle_copy = FingerTree<K, V, M>::concat(
+        middle_copy.force(),
+        FingerTree<K, V, M>::from_nodes(packed)
+      );
+      right = right.subspan(right.size() - 3);
+    }
+
+    return FingerTree<K, V, M>::deep_smart(left, middle_copy, right);
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::size() const -> uint {
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::size() const -> uint {
     this->assert_init();
 
     if (this->is_empty()) {
@@ -302,8 +862,24 @@ namespace collections::finger_tree {
     return this->as_deep()._size;
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::get(K const& key) const -> V const* {
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::measure() const -> typename M::Type {
+    this->assert_init();
+
+    if (this->is_empty()) {
+      return M::identity();
+    }
+
+    if (this->is_single()) {
+      return this->as_single().node().measure();
+    }
+
+    return this->as_deep()._measure;
+  }
+
+  template<typename K, typename V, typename M>
+  template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+  auto FingerTree<K, V, M>::get(Q const& key) const -> V const* {
     this->assert_init();
 
     if (this->is_empty()) {
@@ -313,7 +889,7 @@ namespace collections::finger_tree {
     if (this->is_single()) {
       const auto& single = this->as_single();
 
-      if (single.key() >= key) {
+      if (measure::compare<K, M>(single.key(), key) >= 0) {
         return single.node().get(key);
       } else {
         return nullptr;
@@ -321,358 +897,1542 @@ namespace collections::finger_tree {
     }
 
     const auto& deep = this->as_deep();
-    if (deep.left().key() >= key) {
+    if (measure::compare<K, M>(deep.left().key(), key) >= 0) {
       return deep.left().get(key);
     }
 
     const auto& middle = deep.middle();
     bool is_middle = false;
     if (middle.is_single()) {
-      is_middle = middle.as_single().key() >= key;
+      is_middle = measure::compare<K, M>(middle.as_single().key(), key) >= 0;
     }
 
     if (middle.is_deep()) {
-      is_middle = middle.as_deep().key() >= key;
+      is_middle = measure::compare<K, M>(middle.as_deep().key(), key) >= 0;
     }
 
     if (is_middle) {
       return middle.get(key);
     }
 
-    if (deep.right().key() >= key) {
+    if (measure::compare<K, M>(deep.right().key(), key) >= 0) {
       return deep.right().get(key);
     }
 
     return nullptr;
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::push(Direction dir, K const& key, V const& val) -> void {
-    this->push_node(dir, Node<K, V>(key, val));
-  }
-
-  template<typename K, typename V>
-  auto FingerTree<K, V>::pop(Direction dir) -> std::optional<std::pair<K, V>> {
-    auto node = this->pop_node(dir);
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::at(uint index) const -> std::pair<K const&, V const&> {
+    this->assert_init();
 
-    std::optional<std::pair<K, V>> unpacked;
-    if (node) {
-      unpacked = std::optional(std::pair(
-        node->as_leaf().key(),
-        node->as_leaf().val()
-      ));
+    if (index >= this->size()) {
+      throw std::out_of_range("index out of range for finger tree");
     }
 
-    return unpacked;
-  }
-
-  template<typename K, typename V>
-  auto FingerTree<K, V>::insert(
-    K const& key,
-    V const& val
-  ) -> std::optional<V> {
-    auto [left, found, right] = this->split(key);
-    left.push_node(Direction::Right, Node<K, V>(key, val));
-    *this = FingerTree<K, V>::concat(left, right);
-    return found;
-  }
+    if (this->is_single()) {
+      return this->as_single().node().at(index);
+    }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::remove(K const& key) -> std::optional<V> {
-    auto [left, found, right] = this->split(key);
-    *this = FingerTree<K, V>::concat(left, right);
-    return found;
-  }
+    const auto& deep = this->as_deep();
+    if (index < deep.left().size()) {
+      return deep.left().at(index);
+    }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::split(
-    const K& key
-  ) const -> std::tuple<FingerTree<K, V>, std::optional<V>, FingerTree<K, V>> {
-    auto [left, node, right] = this->split_node(key);
-    std::optional<V> unpacked;
+    index -= deep.left().size();
 
-    if (node) {
-      const auto& leaf = node->as_leaf();
-      if (leaf.key() == key) {
-        unpacked = std::optional(leaf.val());
-      } else {
-        right.push_node(Direction::Left, *node);
-      }
+    // NOTE: the size of the middle tree is known without forcing it
+    if (index < deep.lazy_middle().size()) {
+      return deep.middle().at(index);
     }
 
-    return std::tuple(left, unpacked, right);
+    index -= deep.lazy_middle().size();
+    return deep.right().at(index);
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::push_node(
-    Direction dir,
-    Node<K, V> const& node
-  ) -> void {
+  template<typename K, typename V, typename M>
+  template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+  auto FingerTree<K, V, M>::rank(Q const& key) const -> uint {
+    this->assert_init();
+
     if (this->is_empty()) {
-      this->set(FingerTreeSingle<K, V>(node));
-      return;
+      return 0;
     }
 
     if (this->is_single()) {
-      Node<K, V> other = this->as_single().node();
-      this->set(FingerTreeDeep<K, V>(
-          Digits<K, V>(dir == Direction::Left ? node : other),
-          FingerTree<K, V>(),
-          Digits<K, V>(dir == Direction::Left ? other : node)
-      ));
-      return;
+      return this->as_single().node().rank(key);
     }
 
-    // TODO: do not unconditionally copy, use ensure_unique
     const auto& deep = this->as_deep();
+    if (measure::compare<K, M>(deep.left().key(), key) >= 0) {
+      return deep.left().rank(key);
+    }
 
-    Digits<K, V> left = deep.left();
-    Digits<K, V> right = deep.right();
-    FingerTree<K, V> middle = deep.middle();
+    const auto& middle = deep.middle();
+    bool is_middle = false;
+    if (middle.is_single()) {
+      is_middle = measure::compare<K, M>(middle.as_single().key(), key) >= 0;
+    }
 
-    std::optional<Node<K, V>> overflow;
-    switch (dir) {
-      case Direction::Left:
-        if (left.digit_size() == 4) {
-          overflow = std::optional(Node<K, V>(left.pack(Direction::Right)));
-        }
-        left.push(Direction::Left, node);
-        break;
-      case Direction::Right:
-        if (right.digit_size() == 4) {
-          overflow = std::optional(Node<K, V>(right.pack(Direction::Left)));
-        }
-        right.push(Direction::Right, node);
-        break;
+    if (middle.is_deep()) {
+      is_middle = measure::compare<K, M>(middle.as_deep().key(), key) >= 0;
     }
 
-    if (overflow) {
-      middle.push_node(dir, *overflow);
+    if (is_middle) {
+      return deep.left().size() + middle.rank(key);
     }
 
-    this->set(FingerTreeDeep<K, V>(left, middle, right));
+    return deep.left().size() + middle.size() + deep.right().rank(key);
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::pop_node(Direction dir) -> std::optional<Node<K, V>> {
-    if (this->is_empty()) {
-      return std::optional<Node<K, V>>();
-    }
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::push(Direction dir, K const& key, V const& val) -> void {
+    this->push_node(dir, Node<K, V, M>(key, val));
+  }
 
-    if (this->is_single()) {
-      Node<K, V> node = this->as_single().node();
-      this->set(FingerTreeEmpty<K, V>());
-      return node;
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::push(Direction dir, K&& key, V&& val) -> void {
+    this->push_node(dir, Node<K, V, M>(std::in_place, std::move(key), std::move(val)));
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::pop(Direction dir) -> std::optional<std::pair<K, V>> {
+    auto node = this->pop_node(dir);
+
+    std::optional<std::pair<K, V>> unpacked;
+    if (node) {
+      unpacked = std::optional(node->take_pair());
     }
 
-    // TODO: do not unconditionally copy, use ensure_unique
-    const auto& deep = this->as_deep();
+    return unpacked;
+  }
 
-    Digits<K, V> left = deep.left();
-    Digits<K, V> right = deep.right();
-    FingerTree<K, V> middle = deep.middle();
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::insert(
+    K const& key,
+    V const& val
+  ) -> std::optional<V> {
+    return this->insert_node(key, Node<K, V, M>(key, val));
+  }
 
-    if (middle.is_empty()) {
-      if (left.digit_size() == 1 && right.digit_size() == 1) {
-        this->set(FingerTreeSingle<K, V>(
-          dir == Direction::Left ? right.digits().back() : left.digits().front()
-        ));
-        return Node<K, V>(
-          dir == Direction::Left ? left.digits().front() : right.digits().back()
-        );
-      }
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::insert(K&& key, V&& val) -> std::optional<V> {
+    return this->emplace(std::move(key), std::move(val));
+  }
 
-      if (dir == Direction::Left && left.digit_size() == 1) {
-        Node<K, V> other = right.left();
-        right.pop(Direction::Left);
-        left.push(Direction::Right, other);
-        Node<K, V> node = left.left();
-        left.pop(Direction::Left);
-        this->set(FingerTreeDeep<K, V>(left, middle, right));
-        return node;
-      }
+  template<typename K, typename V, typename M>
+  template<typename... Args>
+  auto FingerTree<K, V, M>::emplace(K key, Args&&... args) -> std::optional<V> {
+    // NOTE: the key is moved into the leaf, which outlives the insert
+    Node<K, V, M> leaf(std::in_place, std::move(key), std::forward<Args>(args)...);
+    return this->insert_node(leaf.key(), leaf);
+  }
 
-      if (dir == Direction::Right && right.digit_size() == 1) {
-        Node<K, V> other = left.right();
-        left.pop(Direction::Right);
-        right.push(Direction::Left, other);
-        Node<K, V> node = right.right();
-        right.pop(Direction::Right);
-        this->set(FingerTreeDeep<K, V>(left, middle, right));
-        return node;
-      }
-    }
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::remove(K const& key) -> std::optional<V> {
+    // NOTE: the top level tree only contains leaves, those are removed
+    // entirely and never leave a remaining child
+    return this->remove_node(key).first;
+  }
 
-    if (dir == Direction::Left && left.digit_size() > 1) {
-      Node<K, V> node = left.left();
-      left.pop(Direction::Left);
-      this->set(FingerTreeDeep<K, V>(left, middle, right));
-      return node;
-    }
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::insert_batch(std::span<std::pair<K, V> const> pairs) -> uint {
+    this->assert_init();
 
-    if (dir == Direction::Right && right.digit_size() > 1) {
-      Node<K, V> node = right.right();
-      right.pop(Direction::Right);
-      this->set(FingerTreeDeep<K, V>(left, middle, right));
-      return node;
+    if (pairs.empty()) {
+      return 0;
     }
 
-    // NOTE: we know middle is not empty
-    Node<K, V> underflow = *middle.pop_node(dir);
-    std::optional<Node<K, V>> node;
+    ScratchArena::Scope scope;
 
-    switch (dir) {
-      case Direction::Left:
-        // NOTE: a middle tree cannot contain leaves
-        left.unpack(Direction::Right, underflow.as_deep());
-        node = std::optional(left.left());
-        left.pop(Direction::Left);
-        break;
-      case Direction::Right:
-        // NOTE: a middle tree cannot contain leaves
-        right.unpack(Direction::Left, underflow.as_deep());
-        node = std::optional(right.right());
-        right.pop(Direction::Right);
-        break;
+    // NOTE: the leaves are sorted instead of the pairs, which only moves
+    // pointers around, the sort is stable, so the last value of duplicate
+    // keys is the last one in its run
+    ScratchVector<Node<K, V, M>> leaves;
+    leaves.reserve(pairs.size());
+    for (const auto& [key, val] : pairs) {
+      leaves.emplace_back(key, val);
     }
 
-    this->set(FingerTreeDeep<K, V>(left, middle, right));
-    return node;
-  }
+    std::stable_sort(leaves.begin(), leaves.end(), [](auto const& a, auto const& b) {
+      return measure::compare<K, M>(a.key(), b.key()) < 0;
+    });
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::append_nodes(
-    Direction dir,
-    std::span<Node<K, V> const> nodes
-  ) -> void {
-    if (dir == Direction::Left) {
-      for (auto it = nodes.rbegin(); it != nodes.rend(); it++) {
-        this->push_node(Direction::Left, *it);
+    uint unique = 0;
+    for (uint i = 0; i < leaves.size(); i++) {
+      if (i + 1 < leaves.size() && measure::compare<K, M>(leaves[i].key(), leaves[i + 1].key()) == 0) {
+        continue;
       }
-    } else {
-      for (const auto& node : nodes) {
-        this->push_node(Direction::Right, node);
+
+      if (unique != i) {
+        leaves[unique] = std::move(leaves[i]);
       }
+
+      unique++;
     }
-  }
+    leaves.resize(unique);
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::take_nodes(
-    Direction dir,
-    uint count
-  ) -> std::vector<Node<K, V>> {
-    count = std::min(count, this->size());
+    auto [tree, count] = this->insert_leaves(leaves);
+    *this = std::move(tree);
+    return count;
+  }
 
-    std::vector<Node<K, V>> nodes;
-    nodes.reserve(count);
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::remove_batch(std::span<K const> keys) -> uint {
+    this->assert_init();
 
-    for (uint i = 0; i <= count; i++) {
-      // NOTE: we've asserted that at least this many elements exist
-      nodes.emplace_back(*this->pop_node(dir));
+    if (keys.empty()) {
+      return 0;
     }
 
-    if (dir == Direction::Right) {
-      std::reverse(nodes.begin(), nodes.end());
-    }
+    std::vector<K> batch(keys.begin(), keys.end());
+    std::sort(batch.begin(), batch.end(), [](auto const& a, auto const& b) {
+      return measure::compare<K, M>(a, b) < 0;
+    });
 
-    return nodes;
+    batch.erase(std::unique(batch.begin(), batch.end(), [](auto const& a, auto const& b) {
+      return measure::compare<K, M>(a, b) == 0;
+    }), batch.end());
+
+    // NOTE: the nodes of the outermost tree are leaves, so nothing less deep
+    // can be left over
+    auto [tree, count, rest] = this->remove_keys(batch, 0);
+    *this = std::move(tree);
+    return count;
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::split_node(const K& key) const -> std::tuple<
-    FingerTree<K, V>,
-    std::optional<Node<K, V>>,
-    FingerTree<K, V>
-  > {
-    if (this->is_empty()) {
-      return std::tuple(FingerTree(), std::optional<Node<K, V>>(), FingerTree());
-    }
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::transient() const -> Transient<K, V, M> {
+    this->assert_init();
+    return Transient<K, V, M>(*this);
+  }
 
-    if (this->is_single()) {
-      const auto& single = this->as_single();
-      if (single.key() >= key) {
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::begin() const -> Iterator<K, V, M> {
+    return Iterator<K, V, M>::begin(*this);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::end() const -> Iterator<K, V, M> {
+    return Iterator<K, V, M>::end(*this);
+  }
+
+  template<typename K, typename V, typename M>
+  template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+  auto FingerTree<K, V, M>::lower_bound(Q const& key) const -> Iterator<K, V, M> {
+    return Iterator<K, V, M>::lower_bound(*this, key);
+  }
+
+  template<typename K, typename V, typename M>
+  template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+  auto FingerTree<K, V, M>::upper_bound(Q const& key) const -> Iterator<K, V, M> {
+    // NOTE: keys are unique, so at most the key itself must be skipped
+    auto it = Iterator<K, V, M>::lower_bound(*this, key);
+    if (!it.is_end() && measure::compare<K, M>(it.key(), key) == 0) {
+      ++it;
+    }
+
+    return it;
+  }
+
+  template<typename K, typename V, typename M>
+  template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+  auto FingerTree<K, V, M>::equal_range(
+    Q const& key
+  ) const -> std::pair<Iterator<K, V, M>, Iterator<K, V, M>> {
+    auto first = Iterator<K, V, M>::lower_bound(*this, key);
+    auto last = first;
+    if (!last.is_end() && measure::compare<K, M>(last.key(), key) == 0) {
+      ++last;
+    }
+
+    return std::pair(first, last);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::insert_by_split(
+    K const& key,
+    V const& val
+  ) -> std::optional<V> {
+    auto [left, found, right] = this->split(key);
+    left.push_node(Direction::Right, Node<K, V, M>(key, val));
+    *this = FingerTree<K, V, M>::concat(left, right);
+    return found;
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::remove_by_split(K const& key) -> std::optional<V> {
+    auto [left, found, right] = this->split(key);
+    *this = FingerTree<K, V, M>::concat(left, right);
+    return found;
+  }
+
+  template<typename K, typename V, typename M>
+  template<compare::Lookup<K, typename measure::CompareOf<K, M>::Type> Q>
+  auto FingerTree<K, V, M>::split(
+    Q const& key
+  ) const& -> std::tuple<FingerTree<K, V, M>, std::optional<V>, FingerTree<K, V, M>> {
+    auto [left, node, right] = this->split_node(key);
+    std::optional<V> unpacked;
+
+    if (node) {
+      const auto& leaf = node->as_leaf();
+      if (measure::compare<K, M>(leaf.key(), key) == 0) {
+        unpacked = std::optional(leaf.val());
+      } else {
+        right.push_node(Direction::Left, *node);
+      }
+    }
+
+    return std::tuple(left, unpacked, right);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::split(
+    const K& key
+  ) && -> std::tuple<FingerTree<K, V, M>, std::optional<V>, FingerTree<K, V, M>> {
+    auto [left, node, right] = this->split_node(key);
+
+    // NOTE: dropping this tree first leaves the parts only the result refers
+    // to uniquely owned
+    *this = FingerTree<K, V, M>();
+
+    std::optional<V> unpacked;
+    if (node) {
+      if (measure::compare<K, M>(node->key(), key) == 0) {
+        unpacked = std::optional(node->take_val());
+      } else {
+        right.push_node(Direction::Left, *node);
+      }
+    }
+
+    return std::tuple(std::move(left), std::move(unpacked), std::move(right));
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::slice(K const& lo, K const& hi) const -> FingerTree<K, V, M> {
+    this->assert_init();
+
+    if (measure::compare<K, M>(lo, hi) >= 0) {
+      return FingerTree();
+    }
+
+    auto [left, rest] = this->split_before(lo);
+    return rest.split_before(hi).first;
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::erase_range(K const& lo, K const& hi) -> uint {
+    this->assert_init();
+
+    if (measure::compare<K, M>(lo, hi) >= 0) {
+      return 0;
+    }
+
+    auto [left, rest] = this->split_before(lo);
+    auto [middle, right] = rest.split_before(hi);
+    if (middle.is_empty()) {
+      return 0;
+    }
+
+    // NOTE: drop the tree and the rest it was split from first, so the halves
+    // are the only owners of their spines and are joined in place
+    auto count = middle.size();
+    rest = FingerTree<K, V, M>();
+    *this = FingerTree<K, V, M>();
+
+    *this = FingerTree<K, V, M>::concat_inner(std::move(left), {}, std::move(right));
+    return count;
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto FingerTree<K, V, M>::split_before(
+    Q const& key
+  ) const -> std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>> {
+    auto [left, node, right] = this->split_node(key);
+    if (node) {
+      right.push_node(Direction::Left, *node);
+    }
+
+    return std::pair(left, right);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::split_at(
+    uint index
+  ) const -> std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>> {
+    this->assert_init();
+
+    if (index >= this->size()) {
+      return std::pair(*this, FingerTree());
+    }
+
+    auto [left, node, right] = this->split_node_at(index);
+
+    // NOTE: the index is in range, so there is a node
+    right.push_node(Direction::Left, *node);
+    return std::pair(left, right);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::take(uint count) const -> FingerTree<K, V, M> {
+    return this->split_at(count).first;
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::drop(uint count) const -> FingerTree<K, V, M> {
+    return this->split_at(count).second;
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename P>
+  auto FingerTree<K, V, M>::split_by(P const& pred) const -> std::tuple<
+    FingerTree<K, V, M>,
+    std::optional<std::pair<K, V>>,
+    FingerTree<K, V, M>
+  > {
+    if (this->is_empty() || !pred(this->measure())) {
+      return std::tuple(*this, std::optional<std::pair<K, V>>(), FingerTree());
+    }
+
+    auto [left, node, right] = this->split_node_by(pred, M::identity());
+
+    // NOTE: the predicate is true for the whole tree, so there is a node
+    const auto& leaf = node->as_leaf();
+    return std::tuple(left, std::optional(std::pair(leaf.key(), leaf.val())), right);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::push_node(
+    Direction dir,
+    Node<K, V, M> const& node
+  ) -> void {
+    if (this->is_empty()) {
+      this->set(FingerTreeSingle<K, V, M>(node));
+      return;
+    }
+
+    if (this->is_single()) {
+      Node<K, V, M> other = this->as_single().node();
+      this->set(FingerTreeDeep<K, V, M>(
+          Digits<K, V, M>(dir == Direction::Left ? node : other),
+          FingerTree<K, V, M>(),
+          Digits<K, V, M>(dir == Direction::Left ? other : node)
+      ));
+      return;
+    }
+
+    // the spine is only copied if it is shared, the digits are stored inline
+    // and the middle tree is then modified in place, this in turn copies it
+    // only if it is shared
+    this->ensure_unique();
+    auto& deep = this->as_deep_mut();
+
+    Digits<K, V, M>& left = deep.left();
+    Digits<K, V, M>& right = deep.right();
+    Suspension<K, V, M>& middle = deep.lazy_middle();
+
+    std::optional<Node<K, V, M>> overflow;
+    switch (dir) {
+      case Direction::Left:
+        if (left.digit_size() == 4) {
+          overflow = std::optional(left.pack(Direction::Right));
+        }
+        left.push(Direction::Left, node);
+        break;
+      case Direction::Right:
+        if (right.digit_size() == 4) {
+          overflow = std::optional(right.pack(Direction::Left));
+        }
+        right.push(Direction::Right, node);
+        break;
+    }
+
+    if (overflow) {
+      middle.push(dir, *overflow);
+    }
+
+    deep._size += node.size();
+    deep._measure = dir == Direction::Left
+      ? M::combine(node.measure(), deep._measure)
+      : M::combine(deep._measure, node.measure());
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::pop_node(Direction dir) -> std::optional<Node<K, V, M>> {
+    if (this->is_empty()) {
+      return std::optional<Node<K, V, M>>();
+    }
+
+    if (this->is_single()) {
+      Node<K, V, M> node = this->as_single().node();
+      this->set(FingerTreeEmpty<K, V, M>());
+      return node;
+    }
+
+    if (this->as_deep().lazy_middle().is_empty()) {
+      const auto& deep = this->as_deep();
+      if (deep.left().digit_size() == 1 && deep.right().digit_size() == 1) {
+        Node<K, V, M> node = dir == Direction::Left
+          ? deep.left().left()
+          : deep.right().right();
+        Node<K, V, M> other = dir == Direction::Left
+          ? deep.right().right()
+          : deep.left().left();
+
+        this->set(FingerTreeSingle<K, V, M>(other));
+        return node;
+      }
+    }
+
+    // see push_node
+    this->ensure_unique();
+    auto& deep = this->as_deep_mut();
+
+    Digits<K, V, M>& left = deep.left();
+    Digits<K, V, M>& right = deep.right();
+    Suspension<K, V, M>& middle = deep.lazy_middle();
+
+    std::optional<Node<K, V, M>> node;
+
+    if (middle.is_empty() && dir == Direction::Left && left.digit_size() == 1) {
+      Node<K, V, M> other = right.left();
+      right.pop(Direction::Left);
+      left.push(Direction::Right, other);
+    }
+
+    if (middle.is_empty() && dir == Direction::Right && right.digit_size() == 1) {
+      Node<K, V, M> other = left.right();
+      left.pop(Direction::Right);
+      right.push(Direction::Left, other);
+    }
+
+    if (dir == Direction::Left && left.digit_size() > 1) {
+      node = std::optional(left.left());
+      left.pop(Direction::Left);
+    } else if (dir == Direction::Right && right.digit_size() > 1) {
+      node = std::optional(right.right());
+      right.pop(Direction::Right);
+    } else {
+      // NOTE: we know middle is not empty
+      Node<K, V, M> underflow = *middle.pop(dir);
+
+      switch (dir) {
+        case Direction::Left:
+          // NOTE: a middle tree cannot contain leaves
+          left.unpack(Direction::Right, underflow.as_deep());
+          node = std::optional(left.left());
+          left.pop(Direction::Left);
+          break;
+        case Direction::Right:
+          // NOTE: a middle tree cannot contain leaves
+          right.unpack(Direction::Left, underflow.as_deep());
+          node = std::optional(right.right());
+          right.pop(Direction::Right);
+          break;
+      }
+    }
+
+    deep._size -= node->size();
+    deep.update_measure();
+    return node;
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::peek_node(Direction dir) const -> std::optional<Node<K, V, M>> {
+    if (this->is_empty()) {
+      return std::optional<Node<K, V, M>>();
+    }
+
+    if (this->is_single()) {
+      return this->as_single().node();
+    }
+
+    const auto& deep = this->as_deep();
+    return dir == Direction::Left ? deep.left().left() : deep.right().right();
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::append_nodes(
+    Direction dir,
+    std::span<Node<K, V, M> const> nodes
+  ) -> void {
+    if (dir == Direction::Left) {
+      for (auto it = nodes.rbegin(); it != nodes.rend(); it++) {
+        this->push_node(Direction::Left, *it);
+      }
+    } else {
+      for (const auto& node : nodes) {
+        this->push_node(Direction::Right, node);
+      }
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto FingerTree<K, V, M>::split_node(Q const& key) const -> std::tuple<
+    FingerTree<K, V, M>,
+    std::optional<Node<K, V, M>>,
+    FingerTree<K, V, M>
+  > {
+    if (this->is_empty()) {
+      return std::tuple(FingerTree(), std::optional<Node<K, V, M>>(), FingerTree());
+    }
+
+    if (this->is_single()) {
+      const auto& single = this->as_single();
+      if (measure::compare<K, M>(single.key(), key) >= 0) {
         return std::tuple(FingerTree(), std::optional(single.node()), FingerTree());
       }
 
-      return std::tuple(*this, std::optional<Node<K, V>>(), FingerTree());
+      return std::tuple(*this, std::optional<Node<K, V, M>>(), FingerTree());
+    }
+
+    const auto& deep = this->as_deep();
+    const auto& middle = deep.middle();
+
+    if (measure::compare<K, M>(deep.left().key(), key) >= 0) {
+      auto [left, node, right] = deep.left().split(key);
+        return std::tuple(
+        FingerTree<K, V, M>::from_nodes(left),
+        node,
+        FingerTree<K, V, M>::deep_smart(right, middle, deep.right().digits())
+      );
+    }
+
+    bool is_middle = false;
+    if (middle.is_single()) {
+      is_middle = measure::compare<K, M>(middle.as_single().key(), key) >= 0;
+    }
+
+    if (middle.is_deep()) {
+      is_middle = measure::compare<K, M>(middle.as_deep().key(), key) >= 0;
+    }
+
+    if (is_middle) {
+      auto [left, packed_node, right] = middle.split_node(key);
+
+      // NOTE: middle cannot contain leaves and is not empty
+      auto [inner_left, node, inner_right] = packed_node->as_deep().split(key);
+      return std::tuple(
+        FingerTree<K, V, M>::deep_smart(deep.left().digits(), left, inner_left),
+        node,
+        FingerTree<K, V, M>::deep_smart(inner_right, right, deep.right().digits())
+      );
+    }
+
+    auto [left, node, right] = deep.right().split(key);
+    return std::tuple(
+      FingerTree<K, V, M>::deep_smart(deep.left().digits(), middle, left),
+      node,
+      FingerTree<K, V, M>::from_nodes(right)
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::split_node_at(uint index) const -> std::tuple<
+    FingerTree<K, V, M>,
+    std::optional<Node<K, V, M>>,
+    FingerTree<K, V, M>
+  > {
+    if (this->is_single()) {
+      return std::tuple(FingerTree(), std::optional(this->as_single().node()), FingerTree());
+    }
+
+    const auto& deep = this->as_deep();
+    const auto& middle = deep.middle();
+
+    if (index < deep.left().size()) {
+      auto [left, node, right] = deep.left().split_at(index);
+      return std::tuple(
+        FingerTree<K, V, M>::from_nodes(left),
+        node,
+        FingerTree<K, V, M>::deep_smart(right, middle, deep.right().digits())
+      );
+    }
+
+    index -= deep.left().size();
+
+    if (index < middle.size()) {
+      auto [left, packed_node, right] = middle.split_node_at(index);
+
+      // NOTE: middle cannot contain leaves and the packed node contains the
+      // index
+      auto [inner_left, node, inner_right] = packed_node->as_deep().split_at(index - left.size());
+      return std::tuple(
+        FingerTree<K, V, M>::deep_smart(deep.left().digits(), left, inner_left),
+        node,
+        FingerTree<K, V, M>::deep_smart(inner_right, right, deep.right().digits())
+      );
+    }
+
+    index -= middle.size();
+
+    auto [left, node, right] = deep.right().split_at(index);
+    return std::tuple(
+      FingerTree<K, V, M>::deep_smart(deep.left().digits(), middle, left),
+      node,
+      FingerTree<K, V, M>::from_nodes(right)
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename P>
+  auto FingerTree<K, V, M>::split_node_by(
+    P const& pred,
+    typename M::Type const& acc
+  ) const -> std::tuple<
+    FingerTree<K, V, M>,
+    std::optional<Node<K, V, M>>,
+    FingerTree<K, V, M>
+  > {
+    if (this->is_single()) {
+      return std::tuple(FingerTree(), std::optional(this->as_single().node()), FingerTree());
+    }
+
+    const auto& deep = this->as_deep();
+    const auto& middle = deep.middle();
+
+    auto left_acc = M::combine(acc, deep.left().measure());
+    if (pred(left_acc)) {
+      auto [left, node, right] = deep.left().split_by(pred, acc);
+      return std::tuple(
+        FingerTree<K, V, M>::from_nodes(left),
+        node,
+        FingerTree<K, V, M>::deep_smart(right, middle, deep.right().digits())
+      );
+    }
+
+    auto middle_acc = M::combine(left_acc, middle.measure());
+    if (!middle.is_empty() && pred(middle_acc)) {
+      auto [left, packed_node, right] = middle.split_node_by(pred, left_acc);
+
+      // NOTE: middle cannot contain leaves and the packed node must contain
+      // the split point
+      auto inner_acc = M::combine(left_acc, left.measure());
+      auto [inner_left, node, inner_right] = packed_node->as_deep().split_by(pred, inner_acc);
+      return std::tuple(
+        FingerTree<K, V, M>::deep_smart(deep.left().digits(), left, inner_left),
+        node,
+        FingerTree<K, V, M>::deep_smart(inner_right, right, deep.right().digits())
+      );
+    }
+
+    auto [left, node, right] = deep.right().split_by(pred, middle_acc);
+    return std::tuple(
+      FingerTree<K, V, M>::deep_smart(deep.left().digits(), middle, left),
+      node,
+      FingerTree<K, V, M>::from_nodes(right)
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::insert_node(
+    K const& key,
+    Node<K, V, M> const& leaf
+  ) -> std::optional<V> {
+    if (this->is_empty()) {
+      this->set(FingerTreeSingle<K, V, M>(leaf));
+      return std::optional<V>();
+    }
+
+    // only the nodes, digits or middle tree on the path to the key are copied
+    // if they are shared, the others are left untouched
+    this->ensure_unique();
+
+    if (this->is_single()) {
+      auto& single = this->as_single_mut();
+      auto inserted = single._node.insert(key, leaf);
+      if (inserted.overflow) {
+        this->set(FingerTreeDeep<K, V, M>(
+          Digits<K, V, M>(single._node),
+          FingerTree<K, V, M>(),
+          Digits<K, V, M>(*inserted.overflow)
+        ));
+      }
+      return std::move(inserted.found);
+    }
+
+    auto& deep = this->as_deep_mut();
+
+    Digits<K, V, M>& left = deep.left();
+    Digits<K, V, M>& right = deep.right();
+    Suspension<K, V, M>& middle = deep.lazy_middle();
+
+    // NOTE: the middle tree is only forced if the key is not in the left
+    // digits
+    bool is_left = measure::compare<K, M>(left.key(), key) >= 0;
+    bool is_middle = false;
+    if (!is_left) {
+      const auto& forced = middle.force();
+      if (forced.is_single()) {
+        is_middle = measure::compare<K, M>(forced.as_single().key(), key) >= 0;
+      }
+
+      if (forced.is_deep()) {
+        is_middle = measure::compare<K, M>(forced.as_deep().key(), key) >= 0;
+      }
+    }
+
+    std::optional<V> found;
+    if (is_left) {
+      found = left.insert(key, leaf);
+      FingerTree<K, V, M>::digits_overflow(Direction::Left, left, middle);
+    } else if (is_middle) {
+      found = middle.force_mut().insert_node(key, leaf);
+    } else {
+      // NOTE: keys greater than the key of this tree are inserted into the
+      // last node
+      found = right.insert(key, leaf);
+      FingerTree<K, V, M>::digits_overflow(Direction::Right, right, middle);
+    }
+
+    if (!found) {
+      deep._size += 1;
+    }
+
+    deep.update_measure();
+    return found;
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::remove_node(K const& key) -> std::pair<
+    std::optional<V>,
+    std::optional<Node<K, V, M>>
+  > {
+    if (this->is_empty()) {
+      return std::pair(std::optional<V>(), std::optional<Node<K, V, M>>());
+    }
+
+    // see insert_node
+    this->ensure_unique();
+
+    if (this->is_single()) {
+      auto removed = this->as_single_mut()._node.remove(key);
+      if (removed.erased) {
+        this->set(FingerTreeEmpty<K, V, M>());
+      }
+
+      return std::pair(std::move(removed.found), removed.underflow);
+    }
+
+    auto& deep = this->as_deep_mut();
+
+    Digits<K, V, M>& left = deep.left();
+    Digits<K, V, M>& right = deep.right();
+    Suspension<K, V, M>& middle = deep.lazy_middle();
+
+    // NOTE: the middle tree is only forced if the key is not in the left
+    // digits
+    bool is_left = measure::compare<K, M>(left.key(), key) >= 0;
+    bool is_middle = false;
+    if (!is_left) {
+      const auto& forced = middle.force();
+      if (forced.is_single()) {
+        is_middle = measure::compare<K, M>(forced.as_single().key(), key) >= 0;
+      }
+
+      if (forced.is_deep()) {
+        is_middle = measure::compare<K, M>(forced.as_deep().key(), key) >= 0;
+      }
+    }
+
+    if (is_middle) {
+      auto [found, underflow] = middle.force_mut().remove_node(key);
+      if (!found) {
+        return std::pair(std::move(found), std::optional<Node<K, V, M>>());
+      }
+
+      if (underflow) {
+        // NOTE: the middle tree is now empty, its remaining node has the same
+        // depth as our digits and sits in between them
+        left.push(Direction::Right, *underflow);
+        FingerTree<K, V, M>::digits_overflow(Direction::Left, left, middle);
+      }
+
+      deep._size -= 1;
+      deep.update_measure();
+      return std::pair(std::move(found), std::optional<Node<K, V, M>>());
+    }
+
+    Direction dir = is_left ? Direction::Left : Direction::Right;
+    auto& digits = dir == Direction::Left ? left : right;
+
+    auto [found, orphan] = digits.remove(key);
+    if (!found) {
+      return std::pair(std::move(found), std::optional<Node<K, V, M>>());
+    }
+
+    deep._size -= 1;
+    if (digits.digit_size() != 0 && !orphan) {
+      deep.update_measure();
+      return std::pair(std::move(found), std::optional<Node<K, V, M>>());
+    }
+
+    // NOTE: the digits are empty, so the tree must be rebuilt
+    FingerTree<K, V, M> tree = FingerTree<K, V, M>::deep_smart(
+      left.digits(),
+      middle,
+      right.digits()
+    );
+
+    if (orphan) {
+      // the dissolved node was the only one in its digits, so we merge its
+      // remaining child into the outermost node on that side instead
+      //
+      // NOTE: the other digits are not empty, so neither is the tree
+      Node<K, V, M> outer = *tree.pop_node(dir);
+      auto [a, b] = outer.merge(dir, *orphan);
+
+      if (dir == Direction::Left) {
+        if (b) {
+          tree.push_node(Direction::Left, *b);
+        }
+        tree.push_node(Direction::Left, a);
+      } else {
+        tree.push_node(Direction::Right, a);
+        if (b) {
+          tree.push_node(Direction::Right, *b);
+        }
+      }
+    }
+
+    *this = tree;
+    return std::pair(std::move(found), std::optional<Node<K, V, M>>());
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::insert_leaves(
+    std::span<Node<K, V, M> const> leaves
+  ) const -> std::pair<FingerTree<K, V, M>, uint> {
+    if (leaves.empty()) {
+      return std::pair(*this, 0);
+    }
+
+    // NOTE: only the outermost tree can be empty, middle trees are not given
+    // any leaves if they are
+    if (this->is_empty()) {
+      return std::pair(FingerTree<K, V, M>::from_nodes(leaves), leaves.size());
+    }
+
+    if (this->is_single()) {
+      ScratchVector<Node<K, V, M>> nodes;
+      uint count = this->as_single().node().insert_run(leaves, nodes);
+      return std::pair(FingerTree<K, V, M>::from_nodes(nodes), count);
     }
 
     const auto& deep = this->as_deep();
-    const auto& middle = deep.middle();
+    auto until = [&](K const& key) {
+      return std::partition_point(leaves.begin(), leaves.end(), [&](auto const& leaf) {
+        return measure::compare<K, M>(leaf.key(), key) <= 0;
+      }) - leaves.begin();
+    };
+
+    auto left_leaves = leaves.subspan(0, until(deep.left().key()));
+    leaves = leaves.subspan(left_leaves.size());
+
+    // NOTE: the middle tree is only forced if some leaves are not in the left
+    // digits, leaves after it are inserted into the right digits
+    uint count = 0;
+    Suspension<K, V, M> middle = deep.lazy_middle();
+    if (!leaves.empty() && !middle.is_empty()) {
+      const auto& forced = deep.middle();
+      const auto& key = forced.is_single() ? forced.as_single().key() : forced.as_deep().key();
+
+      uint run = until(key);
+      if (run != 0) {
+        auto [inserted, inserted_count] = forced.insert_leaves(leaves.subspan(0, run));
+        middle = inserted;
+        count += inserted_count;
+      }
 
-    if (deep.left().key() >= key) {
-      auto [left, node, right] = deep.left().split(key);
+      leaves = leaves.subspan(run);
+    }
+
+    ScratchVector<Node<K, V, M>> left;
+    ScratchVector<Node<K, V, M>> right;
+    count += Node<K, V, M>::insert_runs(deep.left().digits(), left_leaves, left);
+    count += Node<K, V, M>::insert_runs(deep.right().digits(), leaves, right);
+
+    return std::pair(FingerTree<K, V, M>::deep_packed(left, middle, right), count);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::remove_keys(
+    std::span<K const> keys,
+    uint depth
+  ) const -> std::tuple<
+    FingerTree<K, V, M>,
+    uint,
+    std::optional<std::pair<Node<K, V, M>, uint>>
+  > {
+    using Rest = std::optional<std::pair<Node<K, V, M>, uint>>;
+
+    if (keys.empty() || this->is_empty()) {
+      return std::tuple(*this, 0, Rest());
+    }
+
+    if (this->is_single()) {
+      auto removed = this->as_single().node().remove_run(keys, depth);
+      if (removed.count == 0) {
+        return std::tuple(*this, 0, Rest());
+      }
+
+      if (!removed.node) {
+        return std::tuple(FingerTree<K, V, M>(), removed.count, Rest());
+      }
+
+      if (removed.depth == depth) {
         return std::tuple(
-        FingerTree<K, V>::from_nodes(left),
-        node,
-        FingerTree<K, V>::deep_smart(right, middle, deep.right().digits())
+          FingerTree<K, V, M>(FingerTreeSingle<K, V, M>(*removed.node)),
+          removed.count,
+          Rest()
+        );
+      }
+
+      return std::tuple(
+        FingerTree<K, V, M>(),
+        removed.count,
+        Rest(std::pair(*removed.node, removed.depth))
       );
     }
 
-    bool is_middle = false;
-    if (middle.is_single()) {
-      is_middle = middle.as_single().key() >= key;
+    const auto& deep = this->as_deep();
+    auto until = [&](K const& key) {
+      return std::partition_point(keys.begin(), keys.end(), [&](auto const& k) {
+        return measure::compare<K, M>(k, key) <= 0;
+      }) - keys.begin();
+    };
+
+    auto left_keys = keys.subspan(0, until(deep.left().key()));
+    keys = keys.subspan(left_keys.size());
+
+    // see insert_leaves
+    uint count = 0;
+    Rest middle_rest;
+    Suspension<K, V, M> middle = deep.lazy_middle();
+    if (!keys.empty() && !middle.is_empty()) {
+      const auto& forced = deep.middle();
+      const auto& key = forced.is_single() ? forced.as_single().key() : forced.as_deep().key();
+
+      uint run = until(key);
+      if (run != 0) {
+        auto [removed, removed_count, rest] = forced.remove_keys(keys.subspan(0, run), depth + 1);
+        middle = removed;
+        middle_rest = rest;
+        count += removed_count;
+      }
+
+      keys = keys.subspan(run);
     }
 
-    if (middle.is_deep()) {
-      is_middle = middle.as_deep().key() >= key;
+    ScratchArena::Scope scope;
+    ScratchVector<std::pair<Node<K, V, M>, uint>> left;
+    ScratchVector<std::pair<Node<K, V, M>, uint>> right;
+    left.reserve(9);
+    right.reserve(4);
+
+    count += Node<K, V, M>::remove_runs(deep.left().digits(), left_keys, depth, left);
+    count += Node<K, V, M>::remove_runs(deep.right().digits(), keys, depth, right);
+    if (count == 0) {
+      return std::tuple(*this, 0, Rest());
     }
 
-    if (is_middle) {
-      auto [left, packed_node, right] = middle.split_node(key);
+    if (middle.is_empty()) {
+      // NOTE: what's left of the middle tree sits between the digits, so both
+      // sides are settled together
+      if (middle_rest) {
+        left.push_back(*middle_rest);
+      }
+      left.insert(left.end(), right.begin(), right.end());
 
-      // NOTE: middle cannot contain leaves and is not empty
-      auto [inner_left, node, inner_right] = packed_node->as_deep().split(key);
+      ScratchVector<Node<K, V, M>> nodes;
+      nodes.reserve(left.size());
+
+      auto rest = Node<K, V, M>::settle(left, depth, nodes);
+      return std::tuple(FingerTree<K, V, M>::from_nodes(nodes), count, rest);
+    }
+
+    ScratchVector<Node<K, V, M>> left_nodes;
+    ScratchVector<Node<K, V, M>> right_nodes;
+    left_nodes.reserve(left.size());
+    right_nodes.reserve(right.size());
+
+    auto left_rest = Node<K, V, M>::settle(left, depth, left_nodes);
+    auto right_rest = Node<K, V, M>::settle(right, depth, right_nodes);
+
+    // the middle tree is not empty, so neither is the tree, nodes which
+    // underflowed and had no neighbour in their digits are attached to the
+    // outermost node on their side, like the orphans of remove_node
+    FingerTree<K, V, M> tree = FingerTree<K, V, M>::deep_packed(left_nodes, middle, right_nodes);
+    for (auto [dir, rest] : {std::pair(Direction::Left, left_rest), std::pair(Direction::Right, right_rest)}) {
+      if (!rest) {
+        continue;
+      }
+
+      Node<K, V, M> outer = *tree.pop_node(dir);
+      auto [a, b] = outer.attach(dir, rest->first, depth, rest->second);
+
+      if (dir == Direction::Left) {
+        if (b) {
+          tree.push_node(Direction::Left, *b);
+        }
+        tree.push_node(Direction::Left, a);
+      } else {
+        tree.push_node(Direction::Right, a);
+        if (b) {
+          tree.push_node(Direction::Right, *b);
+        }
+      }
+    }
+
+    return std::tuple(tree, count, Rest());
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::concat(
+    FingerTree<K, V, M> const& left,
+    FingerTree<K, V, M> const& right
+  ) -> FingerTree<K, V, M> {
+    return FingerTree<K, V, M>::concat_inner(left, {}, right);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::concat(
+    FingerTree<K, V, M>&& left,
+    FingerTree<K, V, M>&& right
+  ) -> FingerTree<K, V, M> {
+    left.assert_init();
+    right.assert_init();
+
+    return FingerTree<K, V, M>::concat_inner(std::move(left), {}, std::move(right));
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::merge(
+    FingerTree<K, V, M> const& left,
+    FingerTree<K, V, M> const& right,
+    Execution exec
+  ) -> FingerTree<K, V, M> {
+    left.assert_init();
+    right.assert_init();
+
+    return FingerTree<K, V, M>::merge_inner(
+      left,
+      right,
+      FingerTree<K, V, M>::spawn_levels(exec, left.size() + right.size())
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::intersect(
+    FingerTree<K, V, M> const& left,
+    FingerTree<K, V, M> const& right,
+    Execution exec
+  ) -> FingerTree<K, V, M> {
+    left.assert_init();
+    right.assert_init();
+
+    return FingerTree<K, V, M>::intersect_inner(
+      left,
+      right,
+      FingerTree<K, V, M>::spawn_levels(exec, left.size() + right.size())
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::difference(
+    FingerTree<K, V, M> const& left,
+    FingerTree<K, V, M> const& right,
+    Execution exec
+  ) -> FingerTree<K, V, M> {
+    left.assert_init();
+    right.assert_init();
+
+    return FingerTree<K, V, M>::difference_inner(
+      left,
+      right,
+      FingerTree<K, V, M>::spawn_levels(exec, left.size() + right.size())
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::merge_inner(
+    FingerTree<K, V, M> const& left,
+    FingerTree<K, V, M> const& right,
+    uint spawn
+  ) -> FingerTree<K, V, M> {
+    if (left.is_empty()) {
+      return right;
+    }
+
+    if (right.is_empty()) {
+      return left;
+    }
+
+    // NOTE: the copy of the larger tree is modified in place after the first
+    // insert
+    if (left.size() <= SET_CUTOFF && left.size() <= right.size()) {
+      FingerTree<K, V, M> merged = right;
+      for (const auto& [key, val] : left) {
+        merged.insert(key, val);
+      }
+
+      return merged;
+    }
+
+    if (right.size() <= SET_CUTOFF) {
+      FingerTree<K, V, M> merged = left;
+      for (const auto& [key, val] : right) {
+        if (merged.get(key) == nullptr) {
+          merged.insert(key, val);
+        }
+      }
+
+      return merged;
+    }
+
+    auto [lefts, pivot, found, rights] = FingerTree<K, V, M>::split_pivot(left, right);
+    auto [node, is_left] = pivot;
+
+    // NOTE: values of the left tree take precedence
+    if (!is_left && found) {
+      node = Node<K, V, M>(node.key(), *found);
+    }
+
+    auto [merged_left, merged_right] = FingerTree<K, V, M>::fork(
+      spawn,
+      [spawn](auto const& l, auto const& r) {
+        return FingerTree<K, V, M>::merge_inner(l, r, spawn == 0 ? 0 : spawn - 1);
+      },
+      lefts,
+      rights
+    );
+
+    return FingerTree<K, V, M>::concat_inner(
+      merged_left,
+      std::span(&node, 1),
+      merged_right
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::intersect_inner(
+    FingerTree<K, V, M> const& left,
+    FingerTree<K, V, M> const& right,
+    uint spawn
+  ) -> FingerTree<K, V, M> {
+    if (left.is_empty() || right.is_empty()) {
+      return FingerTree();
+    }
+
+    // NOTE: the keys of the smaller tree are visited in order, so the
+    // intersection can be built by pushing
+    if (std::min(left.size(), right.size()) <= SET_CUTOFF) {
+      FingerTree<K, V, M> intersection;
+      if (left.size() <= right.size()) {
+        for (const auto& [key, val] : left) {
+          if (right.get(key) != nullptr) {
+            intersection.push(Direction::Right, key, val);
+          }
+        }
+      } else {
+        for (const auto& [key, val] : right) {
+          if (const auto* left_val = left.get(key)) {
+            intersection.push(Direction::Right, key, *left_val);
+          }
+        }
+      }
+
+      return intersection;
+    }
+
+    auto [lefts, pivot, found, rights] = FingerTree<K, V, M>::split_pivot(left, right);
+    auto [node, is_left] = pivot;
+
+    auto [inter_left, inter_right] = FingerTree<K, V, M>::fork(
+      spawn,
+      [spawn](auto const& l, auto const& r) {
+        return FingerTree<K, V, M>::intersect_inner(l, r, spawn == 0 ? 0 : spawn - 1);
+      },
+      lefts,
+      rights
+    );
+
+    if (!found) {
+      return FingerTree<K, V, M>::concat(inter_left, inter_right);
+    }
+
+    // NOTE: values of the left tree take precedence
+    if (!is_left) {
+      node = Node<K, V, M>(node.key(), *found);
+    }
+
+    return FingerTree<K, V, M>::concat_inner(
+      inter_left,
+      std::span(&node, 1),
+      inter_right
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::difference_inner(
+    FingerTree<K, V, M> const& left,
+    FingerTree<K, V, M> const& right,
+    uint spawn
+  ) -> FingerTree<K, V, M> {
+    if (left.is_empty() || right.is_empty()) {
+      return left;
+    }
+
+    if (right.size() <= SET_CUTOFF) {
+      FingerTree<K, V, M> difference = left;
+      for (const auto& [key, val] : right) {
+        difference.remove(key);
+      }
+
+      return difference;
+    }
+
+    if (left.size() <= SET_CUTOFF) {
+      FingerTree<K, V, M> difference;
+      for (const auto& [key, val] : left) {
+        if (right.get(key) == nullptr) {
+          difference.push(Direction::Right, key, val);
+        }
+      }
+
+      return difference;
+    }
+
+    auto [lefts, pivot, found, rights] = FingerTree<K, V, M>::split_pivot(left, right);
+    auto [node, is_left] = pivot;
+
+    auto [diff_left, diff_right] = FingerTree<K, V, M>::fork(
+      spawn,
+      [spawn](auto const& l, auto const& r) {
+        return FingerTree<K, V, M>::difference_inner(l, r, spawn == 0 ? 0 : spawn - 1);
+      },
+      lefts,
+      rights
+    );
+
+    // the pivot is only kept if it is in the left tree but not in the right
+    if (!is_left || found) {
+      return FingerTree<K, V, M>::concat(diff_left, diff_right);
+    }
+
+    return FingerTree<K, V, M>::concat_inner(
+      diff_left,
+      std::span(&node, 1),
+      diff_right
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::split_pivot(
+    FingerTree<K, V, M> const& left,
+    FingerTree<K, V, M> const& right
+  ) -> std::tuple<
+    std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>>,
+    std::pair<Node<K, V, M>, bool>,
+    std::optional<V>,
+    std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>>
+  > {
+    bool is_left = left.size() <= right.size();
+    const auto& smaller = is_left ? left : right;
+    const auto& larger = is_left ? right : left;
+
+    // NOTE: the smaller tree is not empty
+    auto [smaller_left, pivot, smaller_right] = smaller.split_node_at(smaller.size() / 2);
+    auto [larger_left, found, larger_right] = larger.split(pivot->key());
+
+    if (is_left) {
       return std::tuple(
-        FingerTree<K, V>::deep_smart(deep.left().digits(), left, inner_left),
-        node,
-        FingerTree<K, V>::deep_smart(inner_right, right, deep.right().digits())
+        std::pair(smaller_left, larger_left),
+        std::pair(*pivot, is_left),
+        found,
+        std::pair(smaller_right, larger_right)
       );
     }
 
-    auto [left, node, right] = deep.right().split(key);
     return std::tuple(
-      FingerTree<K, V>::deep_smart(deep.left().digits(), middle, left),
-      node,
-      FingerTree<K, V>::from_nodes(right)
+      std::pair(larger_left, smaller_left),
+      std::pair(*pivot, is_left),
+      found,
+      std::pair(larger_right, smaller_right)
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename F>
+  auto FingerTree<K, V, M>::fork(
+    uint spawn,
+    F const& func,
+    std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>> const& left,
+    std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>> const& right
+  ) -> std::pair<FingerTree<K, V, M>, FingerTree<K, V, M>> {
+    if (spawn == 0) {
+      return std::pair(func(left.first, left.second), func(right.first, right.second));
+    }
+
+    // NOTE: the halves only share nodes, which are never modified in place
+    // while shared, so they can be processed concurrently
+    return ThreadPool::global().join(
+      [&func, &left]() { return func(left.first, left.second); },
+      [&func, &right]() { return func(right.first, right.second); }
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::reserve(uint count) -> void {
+    std::size_t sizes[] = {
+      sizeof(FingerTreeSingle<K, V, M>),
+      sizeof(FingerTreeDeep<K, V, M>),
+      sizeof(NodeLeaf<K, V, M>),
+      sizeof(NodeDeep<K, V, M>),
+#ifdef FINGER_TREE_LAZY
+      // NOTE: pushes and pops on a middle tree allocate a pending operation
+      Suspension<K, V, M>::thunk_size(),
+#endif
+    };
+
+    // NOTE: variants of the same size class share their blocks
+    for (auto size : sizes) {
+      uint shared = 0;
+      for (auto other : sizes) {
+        shared += SlabPool::block_size(other) == SlabPool::block_size(size);
+      }
+
+      SlabPool::reserve(size, count * shared);
+    }
+
+    ScratchArena::reserve();
+    Reclaimer::reserve(count);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::spawn_levels(Execution exec, uint size) -> uint {
+    // NOTE: the nodes of thread local trees must not be copied on other threads
+    if (exec == Execution::Sequential || FingerTree<K, V, M>::IS_LOCAL) {
+      return 0;
+    }
+
+    // NOTE: each level roughly halves the input, the pool balances the
+    // resulting tasks between its workers
+    return std::bit_width(size / PARALLEL_CUTOFF);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::from_sorted_parallel(
+    std::span<std::pair<K, V> const> pairs
+  ) -> FingerTree<K, V, M> {
+    static_assert(!FingerTree<K, V, M>::IS_LOCAL, "thread local trees can't be built in parallel");
+
+    if (pairs.size() <= PARALLEL_CUTOFF) {
+      return FingerTree<K, V, M>::from_sorted(pairs);
+    }
+
+    auto half = pairs.size() / 2;
+
+#ifndef NDEBUG
+    // NOTE: the chunks check their own keys
+    if (measure::compare<K, M>(pairs[half - 1].first, pairs[half].first) >= 0) {
+      throw std::invalid_argument("keys must be sorted in ascending order and unique");
+    }
+#endif
+
+    auto [left, right] = ThreadPool::global().join(
+      [&pairs, half]() { return FingerTree<K, V, M>::from_sorted_parallel(pairs.subspan(0, half)); },
+      [&pairs, half]() { return FingerTree<K, V, M>::from_sorted_parallel(pairs.subspan(half)); }
+    );
+
+    return FingerTree<K, V, M>::concat(left, right);
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename T, typename F, typename C>
+  auto FingerTree<K, V, M>::parallel_reduce(
+    T const& init,
+    F const& func,
+    C const& combine
+  ) const -> T {
+    static_assert(!FingerTree<K, V, M>::IS_LOCAL, "thread local trees can't be traversed in parallel");
+
+    this->assert_init();
+    return this->reduce_range(0, this->size(), init, func, combine);
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename F>
+  auto FingerTree<K, V, M>::parallel_for_each(F const& func) const -> void {
+    struct Unit {};
+
+    this->parallel_reduce(
+      Unit{},
+      [&func](Unit, K const& key, V const& val) { func(key, val); return Unit{}; },
+      [](Unit, Unit) { return Unit{}; }
     );
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::concat(
-    FingerTree<K, V> const& left,
-    FingerTree<K, V> const& right
-  ) -> FingerTree<K, V> {
-    return FingerTree<K, V>::concat_inner(left, std::vector<Node<K, V>>(), right);
+  template<typename K, typename V, typename M>
+  template<typename T, typename F, typename C>
+  auto FingerTree<K, V, M>::reduce_range(
+    uint first,
+    uint last,
+    T const& init,
+    F const& func,
+    C const& combine
+  ) const -> T {
+    // NOTE: chunks are found by index, so they're visited without splitting
+    // the tree
+    if (last - first <= PARALLEL_CUTOFF) {
+      T acc = init;
+      auto it = Iterator<K, V, M>::at(*this, first);
+      for (uint i = first; i < last; i++, ++it) {
+        acc = func(std::move(acc), it.key(), it.val());
+      }
+
+      return acc;
+    }
+
+    uint half = first + (last - first) / 2;
+    auto [left, right] = ThreadPool::global().join(
+      [&]() { return this->reduce_range(first, half, init, func, combine); },
+      [&]() { return this->reduce_range(half, last, init, func, combine); }
+    );
+
+    return combine(left, right);
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::concat_inner(
-    FingerTree<K, V> const& left,
-    std::vector<Node<K, V>> const& middle,
-    FingerTree<K, V> const& right
-  ) -> FingerTree<K, V> {
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::concat_inner(
+    FingerTree<K, V, M> const& left,
+    std::span<Node<K, V, M> const> middle,
+    FingerTree<K, V, M> const& right
+  ) -> FingerTree<K, V, M> {
     if (left.is_empty()) {
-      FingerTree<K, V> copy = right;
+      FingerTree<K, V, M> copy = right;
       copy.append_nodes(Direction::Left, middle);
       return copy;
     }
 
     if (right.is_empty()) {
-      FingerTree<K, V> copy = left;
+      FingerTree<K, V, M> copy = left;
       copy.append_nodes(Direction::Right, middle);
       return copy;
     }
 
     if (left.is_single()) {
-      FingerTree<K, V> copy = right;
+      FingerTree<K, V, M> copy = right;
       copy.append_nodes(Direction::Left, middle);
       copy.push_node(Direction::Left, left.as_single().node());
       return copy;
     }
 
     if (right.is_single()) {
-      FingerTree<K, V> copy = left;
+      FingerTree<K, V, M> copy = left;
       copy.append_nodes(Direction::Right, middle);
       copy.push_node(Direction::Right, right.as_single().node());
       return copy;
@@ -681,8 +2441,12 @@ namespace collections::finger_tree {
     const auto& left_deep = left.as_deep();
     const auto& right_deep = right.as_deep();
 
+    // NOTE: declared first, so the vectors below are destroyed before their
+    // storage is released
+    ScratchArena::Scope scope;
+
     // TODO: this vector can be used as in- and output by packing nodes in place
-    std::vector<Node<K, V>> concat;
+    ScratchVector<Node<K, V, M>> concat;
     concat.reserve(
       left_deep.right().digit_size()
       + middle.size()
@@ -701,13 +2465,13 @@ namespace collections::finger_tree {
       concat.emplace_back(node);
     }
 
-    std::vector<Node<K, V>> packed = Node<K, V>::pack_nodes(
+    ScratchVector<Node<K, V, M>> packed = Node<K, V, M>::pack_nodes(
       std::span(concat)
     );
 
-    return FingerTree(FingerTreeDeep<K, V>(
+    return FingerTree(FingerTreeDeep<K, V, M>(
       left_deep.left(),
-      FingerTree<K, V>::concat_inner(
+      FingerTree<K, V, M>::concat_inner(
         left_deep.middle(),
         packed,
         right_deep.middle()
@@ -716,28 +2480,126 @@ namespace collections::finger_tree {
     ));
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::assert_init() const -> void {
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::concat_inner(
+    FingerTree<K, V, M>&& left,
+    std::span<Node<K, V, M> const> middle,
+    FingerTree<K, V, M>&& right
+  ) -> FingerTree<K, V, M> {
+    // NOTE: unlike the copying definition, the tree which is appended to is
+    // moved, so it is modified in place if nobody else refers to it
+    if (left.is_empty()) {
+      right.append_nodes(Direction::Left, middle);
+      return std::move(right);
+    }
+
+    if (right.is_empty()) {
+      left.append_nodes(Direction::Right, middle);
+      return std::move(left);
+    }
+
+    if (left.is_single()) {
+      right.append_nodes(Direction::Left, middle);
+      right.push_node(Direction::Left, left.as_single().node());
+      return std::move(right);
+    }
+
+    if (right.is_single()) {
+      left.append_nodes(Direction::Right, middle);
+      left.push_node(Direction::Right, right.as_single().node());
+      return std::move(left);
+    }
+
+    // see the copying definition, the inner digits are packed into nodes
+    // between the middle trees
+    ScratchArena::Scope scope;
+
+    ScratchVector<Node<K, V, M>> concat;
+    concat.reserve(
+      left.as_deep().right().digit_size()
+      + middle.size()
+      + right.as_deep().left().digit_size()
+    );
+
+    for (const auto& node : left.as_deep().right().digits()) {
+      concat.emplace_back(node);
+    }
+
+    for (const auto& node : middle) {
+      concat.emplace_back(node);
+    }
+
+    for (const auto& node : right.as_deep().left().digits()) {
+      concat.emplace_back(node);
+    }
+
+    ScratchVector<Node<K, V, M>> packed = Node<K, V, M>::pack_nodes(
+      std::span(concat)
+    );
+
+    FingerTree<K, V, M> inner = FingerTree<K, V, M>::concat_inner(
+      FingerTree<K, V, M>::take_middle(left),
+      packed,
+      FingerTree<K, V, M>::take_middle(right)
+    );
+
+    // the left tree becomes the result, its left digits are kept
+    left.ensure_unique();
+    auto& deep = left.as_deep_mut();
+    deep._middle = Suspension<K, V, M>(inner);
+    deep._right = right.as_deep().right();
+    deep._size = deep._left.size() + deep._middle.size() + deep._right.size();
+    deep.update_measure();
+
+    return std::move(left);
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::take_middle(FingerTree<K, V, M>& tree) -> FingerTree<K, V, M> {
+    // NOTE: see ensure_unique for the threading rules
+    if (!tree._repr.ptr()->_refs.is_unique()) {
+      return tree.as_deep().middle();
+    }
+
+    auto& deep = tree.as_deep_mut();
+    FingerTree<K, V, M> middle = std::move(deep.lazy_middle().force_mut());
+    deep._middle = Suspension<K, V, M>();
+    return middle;
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::digits_overflow(
+    Direction dir,
+    Digits<K, V, M>& digits,
+    Suspension<K, V, M>& middle
+  ) -> void {
+    if (digits.digit_size() == 5) {
+      middle.push(dir, digits.pack(dir == Direction::Left ? Direction::Right : Direction::Left));
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::assert_init() const -> void {
     // make sure we're not working with a moved from instance
     if (this->is_uninit()) {
       throw UninitException("FingerTree is uninitialized");
     }
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::ensure_unique() -> void {
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::ensure_unique() -> void {
     this->assert_init();
 
+    // the empty variant has no state to share
+    if (this->is_empty()) {
+      return;
+    }
+
     // NOTE: no pointers or references to a FingerTree may be sent to another
     // thread, only values of FingerTree, therefore no copy may be done between
     // this check and subsequent writes
-    // if (this->_repr.use_count() == 1) {
-    //   return;
-    // }
-
-    if (this->is_empty()) {
-      const auto& empty = this->as_empty();
-      this->set(empty);
+    if (this->_repr.ptr()->_refs.is_unique()) {
+      return;
     }
 
     if (this->is_single()) {
@@ -751,46 +2613,75 @@ namespace collections::finger_tree {
     }
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::set(FingerTreeEmpty<K, V> empty) -> void {
-    this->_repr = std::static_pointer_cast<FingerTreeBase<K, V>>(
-      std::make_shared<FingerTreeEmpty<K, V>>(empty)
-    );
-    this->_kind = Kind::Empty;
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::set(FingerTreeEmpty<K, V, M>) -> void {
+    this->release();
+    this->_repr = TaggedPtr<FingerTreeBase<K, V, M>>(nullptr, FingerTree<K, V, M>::tag(Kind::Empty));
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::set(FingerTreeSingle<K, V> single) -> void {
-    this->_repr = std::static_pointer_cast<FingerTreeBase<K, V>>(
-      std::make_shared<FingerTreeSingle<K, V>>(single)
-    );
-    this->_kind = Kind::Single;
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::set(FingerTreeSingle<K, V, M> single) -> void {
+    auto repr = new FingerTreeSingle<K, V, M>(std::move(single));
+    this->release();
+    this->_repr = TaggedPtr<FingerTreeBase<K, V, M>>(repr, FingerTree<K, V, M>::tag(Kind::Single));
   }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::set(FingerTreeDeep<K, V> deep) -> void {
-    this->_repr = std::static_pointer_cast<FingerTreeBase<K, V>>(
-      std::make_shared<FingerTreeDeep<K, V>>(deep)
-    );
-    this->_kind = Kind::Deep;
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::set(FingerTreeDeep<K, V, M> deep) -> void {
+    auto repr = new FingerTreeDeep<K, V, M>(std::move(deep));
+    this->release();
+    this->_repr = TaggedPtr<FingerTreeBase<K, V, M>>(repr, FingerTree<K, V, M>::tag(Kind::Deep));
   }
 
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::acquire() const -> void {
+    if (this->is_single() || this->is_deep()) {
+      this->_repr.ptr()->_refs.acquire();
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::release() -> void {
+    if (!(this->is_single() || this->is_deep())) {
+      return;
+    }
+
+    if (!this->_repr.ptr()->_refs.release()) {
+      return;
+    }
+
+    // NOTE: the variants have no virtual destructor, so we delete them as
+    // their concrete type
+    if (this->is_single()) {
+      Reclaimer::dispose(&this->as_single_mut(), FingerTree<K, V, M>::IS_LOCAL);
+    } else {
+      Reclaimer::dispose(&this->as_deep_mut(), FingerTree<K, V, M>::IS_LOCAL);
+    }
+  }
 
-  template<typename K, typename V>
-  auto FingerTree<K, V>::show(
+  template<typename K, typename V, typename M>
+  auto FingerTree<K, V, M>::show(
     std::ostream& os,
     uint indent
   ) const -> std::ostream& {
-    if (this->_repr == nullptr) {
+    if (this->is_uninit()) {
       return os << "null";
     }
 
-    return this->_repr->show(os, indent);
+    if (this->is_empty()) {
+      return this->as_empty().show(os, indent);
+    }
+
+    if (this->is_single()) {
+      return this->as_single().show(os, indent);
+    }
+
+    return this->as_deep().show(os, indent);
   }
 
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, FingerTree<K, V> const& tree) {
+  template<typename K, typename V, typename M>
+  std::ostream& operator<<(std::ostream& os, FingerTree<K, V, M> const& tree) {
     return tree.show(os, 0);
   }
 }
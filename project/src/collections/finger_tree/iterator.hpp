@@ -0,0 +1,454 @@
+#pragma once
+
+// a bidirectional iterator over the key value pairs of a finger tree in key
+// order
+//
+// the iterator keeps an explicit stack of the trees and nodes on the path to
+// its current leaf, the spine stack holds the deep trees and which of their
+// parts we're in, the frame stack holds the digits or nodes of the innermost
+// of these trees down to the leaf, stepping only pops frames until one has a
+// sibling in the right direction and descends from there, which is O(1)
+// amortized
+//
+// both stacks have a fixed depth, a tree at spine level d contains nodes of
+// depth d which hold at least 2^d leaves, so with uint sizes neither stack can
+// be deeper than 32 frames
+//
+// an iterator is invalidated by any modification of the tree it was created
+// from, copies of that tree may be modified freely
+
+#include "src/collections/finger_tree/_prelude.hpp"
+#include "src/collections/finger_tree/core.hpp"
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <sys/types.h>
+#include <utility>
+
+namespace collections::finger_tree {
+  template<typename K, typename V, typename M>
+  class Iterator {
+    public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type = std::pair<K, V>;
+      using reference = std::pair<K, V> const&;
+      using pointer = std::pair<K, V> const*;
+      using difference_type = std::ptrdiff_t;
+
+      static constexpr uint MAX_DEPTH = 32;
+
+    // constructors
+    public:
+      // create an end iterator which does not belong to any tree
+      Iterator();
+
+    public:
+      // create an iterator at the first key value pair of the given tree
+      static auto begin(FingerTree<K, V, M> const& tree) -> Iterator<K, V, M>;
+
+      // create an iterator past the last key value pair of the given tree
+      static auto end(FingerTree<K, V, M> const& tree) -> Iterator<K, V, M>;
+
+      // create an iterator at the first key value pair of the given tree
+      // whose key is not less than the given key
+      template<typename Q>
+      static auto lower_bound(
+        FingerTree<K, V, M> const& tree,
+        Q const& key
+      ) -> Iterator<K, V, M>;
+
+      // create an iterator at the key value pair at the given index of the
+      // given tree, or an end iterator if the index is out of range
+      static auto at(FingerTree<K, V, M> const& tree, uint index) -> Iterator<K, V, M>;
+
+    // accessors
+    public:
+      auto is_end() const -> bool { return this->_frames_size == 0; }
+
+      // the key and value of the current leaf, this must not be called on an
+      // end iterator
+      auto key() const -> K const& { return this->leaf().key(); }
+      auto val() const -> V const& { return this->leaf().val(); }
+
+      auto operator*() const -> reference { return this->leaf().pair(); }
+      auto operator->() const -> pointer { return &this->leaf().pair(); }
+
+    // methods
+    public:
+      auto operator++() -> Iterator<K, V, M>&;
+      auto operator++(int) -> Iterator<K, V, M>;
+
+      // decrementing an end iterator moves it to the last key value pair
+      auto operator--() -> Iterator<K, V, M>&;
+      auto operator--(int) -> Iterator<K, V, M>;
+
+      auto operator==(Iterator<K, V, M> const& other) const -> bool;
+
+    private:
+      enum class Part { Single, Left, Middle, Right };
+
+      // a tree on the path to the current leaf and the part of it we're in
+      struct Spine {
+        FingerTree<K, V, M> const* tree;
+        Part part;
+      };
+
+      // the digits or children of a node on the path to the current leaf
+      struct Frame {
+        Node<K, V, M> const* nodes;
+        uint count;
+        uint index;
+      };
+
+    private:
+      auto leaf() const -> NodeLeaf<K, V, M> const&;
+
+      // move to the next leaf in the given direction, moving past the last
+      // leaf turns this into an end iterator
+      auto step(Direction dir) -> void;
+
+      // enter the given non-empty tree at its outermost leaf on the given
+      // side
+      auto enter(Direction side, FingerTree<K, V, M> const& tree) -> void;
+
+      // push a frame for the given nodes and descend to their outermost leaf
+      // on the given side
+      auto enter(Direction side, std::span<Node<K, V, M> const> nodes) -> void;
+
+      // descend from the current node of the topmost frame to its outermost
+      // leaf on the given side
+      auto descend(Direction side) -> void;
+
+      // push a frame for the given nodes at the node containing the given
+      // index and descend to the leaf at that index, the index must be in range
+      auto seek_index(uint index, std::span<Node<K, V, M> const> nodes) -> void;
+
+      // push a frame for the given nodes at the first node whose key is not
+      // less than the given key and descend to the first such leaf, such a
+      // node must exist
+      template<typename Q>
+      auto seek_key(Q const& key, std::span<Node<K, V, M> const> nodes) -> void;
+
+      auto push(FingerTree<K, V, M> const& tree, Part part) -> void;
+      auto push(std::span<Node<K, V, M> const> nodes, uint index) -> void;
+
+    private:
+      FingerTree<K, V, M> const* _root;
+
+      uint _spine_size;
+      std::array<Spine, MAX_DEPTH> _spine;
+
+      uint _frames_size;
+      std::array<Frame, MAX_DEPTH> _frames;
+  };
+
+  template<typename K, typename V, typename M>
+  Iterator<K, V, M>::Iterator() : _root(nullptr), _spine_size(0), _frames_size(0) {}
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::begin(FingerTree<K, V, M> const& tree) -> Iterator<K, V, M> {
+    auto it = Iterator<K, V, M>::end(tree);
+    if (!tree.is_empty()) {
+      it.enter(Direction::Left, tree);
+    }
+
+    return it;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::end(FingerTree<K, V, M> const& tree) -> Iterator<K, V, M> {
+    tree.assert_init();
+
+    auto it = Iterator<K, V, M>();
+    it._root = &tree;
+    return it;
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto Iterator<K, V, M>::lower_bound(
+    FingerTree<K, V, M> const& tree,
+    Q const& key
+  ) -> Iterator<K, V, M> {
+    auto it = Iterator<K, V, M>::end(tree);
+
+    // NOTE: this descends like FingerTree::get, but records the path
+    FingerTree<K, V, M> const* current = &tree;
+    while (!current->is_empty()) {
+      if (current->is_single()) {
+        const auto& single = current->as_single();
+        if (measure::compare<K, M>(single.key(), key) < 0) {
+          break;
+        }
+
+        it.push(*current, Part::Single);
+        it.seek_key(key, std::span(&single.node(), 1));
+        return it;
+      }
+
+      const auto& deep = current->as_deep();
+      if (measure::compare<K, M>(deep.left().key(), key) >= 0) {
+        it.push(*current, Part::Left);
+        it.seek_key(key, deep.left().digits());
+        return it;
+      }
+
+      const auto& middle = deep.middle();
+      bool is_middle = false;
+      if (middle.is_single()) {
+        is_middle = measure::compare<K, M>(middle.as_single().key(), key) >= 0;
+      }
+
+      if (middle.is_deep()) {
+        is_middle = measure::compare<K, M>(middle.as_deep().key(), key) >= 0;
+      }
+
+      if (is_middle) {
+        it.push(*current, Part::Middle);
+        current = &middle;
+        continue;
+      }
+
+      if (measure::compare<K, M>(deep.right().key(), key) >= 0) {
+        it.push(*current, Part::Right);
+        it.seek_key(key, deep.right().digits());
+        return it;
+      }
+
+      break;
+    }
+
+    // all keys are less than the given key
+    return Iterator<K, V, M>::end(tree);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::at(FingerTree<K, V, M> const& tree, uint index) -> Iterator<K, V, M> {
+    auto it = Iterator<K, V, M>::end(tree);
+    if (index >= tree.size()) {
+      return it;
+    }
+
+    // NOTE: this descends like FingerTree::at, but records the path
+    FingerTree<K, V, M> const* current = &tree;
+    while (true) {
+      if (current->is_single()) {
+        it.push(*current, Part::Single);
+        it.seek_index(index, std::span(&current->as_single().node(), 1));
+        return it;
+      }
+
+      const auto& deep = current->as_deep();
+      if (index < deep.left().size()) {
+        it.push(*current, Part::Left);
+        it.seek_index(index, deep.left().digits());
+        return it;
+      }
+
+      index -= deep.left().size();
+      if (index < deep.lazy_middle().size()) {
+        it.push(*current, Part::Middle);
+        current = &deep.middle();
+        continue;
+      }
+
+      index -= deep.lazy_middle().size();
+      it.push(*current, Part::Right);
+      it.seek_index(index, deep.right().digits());
+      return it;
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::operator++() -> Iterator<K, V, M>& {
+    this->step(Direction::Right);
+    return *this;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::operator++(int) -> Iterator<K, V, M> {
+    auto copy = *this;
+    this->step(Direction::Right);
+    return copy;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::operator--() -> Iterator<K, V, M>& {
+    if (this->is_end()) {
+      if (this->_root != nullptr && !this->_root->is_empty()) {
+        this->enter(Direction::Right, *this->_root);
+      }
+    } else {
+      this->step(Direction::Left);
+    }
+
+    return *this;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::operator--(int) -> Iterator<K, V, M> {
+    auto copy = *this;
+    --*this;
+    return copy;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::operator==(Iterator<K, V, M> const& other) const -> bool {
+    if (this->is_end() || other.is_end()) {
+      return this->is_end() == other.is_end();
+    }
+
+    // NOTE: leaves are owned by exactly one slot in the tree, so their
+    // addresses identify the position
+    return &this->leaf() == &other.leaf();
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::leaf() const -> NodeLeaf<K, V, M> const& {
+    const auto& frame = this->_frames[this->_frames_size - 1];
+    return frame.nodes[frame.index].as_leaf();
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::step(Direction dir) -> void {
+    Direction side = dir == Direction::Left ? Direction::Right : Direction::Left;
+
+    // move to a sibling within the current digits or nodes
+    while (this->_frames_size != 0) {
+      auto& frame = this->_frames[this->_frames_size - 1];
+
+      if (dir == Direction::Right && frame.index + 1 < frame.count) {
+        frame.index++;
+        this->descend(side);
+        return;
+      }
+
+      if (dir == Direction::Left && frame.index > 0) {
+        frame.index--;
+        this->descend(side);
+        return;
+      }
+
+      this->_frames_size--;
+    }
+
+    // the current tree part is exhausted, move along the spine
+    while (this->_spine_size != 0) {
+      auto& spine = this->_spine[this->_spine_size - 1];
+      if (spine.part == Part::Single) {
+        this->_spine_size--;
+        continue;
+      }
+
+      const auto& deep = spine.tree->as_deep();
+      const auto& outer = dir == Direction::Right ? deep.right() : deep.left();
+      Part outer_part = dir == Direction::Right ? Part::Right : Part::Left;
+
+      if (spine.part == outer_part) {
+        this->_spine_size--;
+        continue;
+      }
+
+      if (spine.part != Part::Middle && !deep.lazy_middle().is_empty()) {
+        spine.part = Part::Middle;
+        this->enter(side, deep.middle());
+        return;
+      }
+
+      spine.part = outer_part;
+      this->enter(side, outer.digits());
+      return;
+    }
+
+    // we moved past the outermost leaf
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::enter(Direction side, FingerTree<K, V, M> const& tree) -> void {
+    if (tree.is_single()) {
+      this->push(tree, Part::Single);
+      this->enter(side, std::span(&tree.as_single().node(), 1));
+      return;
+    }
+
+    const auto& deep = tree.as_deep();
+    if (side == Direction::Left) {
+      this->push(tree, Part::Left);
+      this->enter(side, deep.left().digits());
+    } else {
+      this->push(tree, Part::Right);
+      this->enter(side, deep.right().digits());
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::enter(Direction side, std::span<Node<K, V, M> const> nodes) -> void {
+    this->push(nodes, side == Direction::Left ? 0 : nodes.size() - 1);
+    this->descend(side);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::descend(Direction side) -> void {
+    const auto& frame = this->_frames[this->_frames_size - 1];
+
+    // NOTE: the nodes of a frame are owned by the node of the frame below it,
+    // which is kept alive by the tree
+    const auto* node = &frame.nodes[frame.index];
+    while (node->is_deep()) {
+      auto children = node->as_deep().children();
+      uint index = side == Direction::Left ? 0 : children.size() - 1;
+      this->push(children, index);
+      node = &children[index];
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::seek_index(uint index, std::span<Node<K, V, M> const> nodes) -> void {
+    while (true) {
+      uint i = 0;
+      while (!(index < nodes[i].size())) {
+        index -= nodes[i].size();
+        i++;
+      }
+
+      this->push(nodes, i);
+      if (nodes[i].is_leaf()) {
+        return;
+      }
+
+      nodes = nodes[i].as_deep().children();
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto Iterator<K, V, M>::seek_key(Q const& key, std::span<Node<K, V, M> const> nodes) -> void {
+    while (true) {
+      uint index = 0;
+      while (measure::compare<K, M>(nodes[index].key(), key) < 0) {
+        index++;
+      }
+
+      this->push(nodes, index);
+      if (nodes[index].is_leaf()) {
+        return;
+      }
+
+      nodes = nodes[index].as_deep().children();
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::push(FingerTree<K, V, M> const& tree, Part part) -> void {
+    this->_spine[this->_spine_size] = Spine{&tree, part};
+    this->_spine_size++;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Iterator<K, V, M>::push(std::span<Node<K, V, M> const> nodes, uint index) -> void {
+    this->_frames[this->_frames_size] = Frame{nodes.data(), static_cast<uint>(nodes.size()), index};
+    this->_frames_size++;
+  }
+}
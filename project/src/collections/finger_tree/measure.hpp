@@ -0,0 +1,110 @@
+#pragma once
+
+// measures which can be cached in the nodes of a finger tree
+//
+// besides the key and size every node and digit of a finger tree caches a
+// user defined measure of the key value pairs below it, a measure is a monoid
+// given by a type with the following static members
+//
+//   using Type = ...;
+//   static auto identity() -> Type;
+//   static auto combine(Type const& a, Type const& b) -> Type;
+//   static auto measure(K const& key, V const& val) -> Type;
+//
+// combine must be associative and identity must be neutral for it, it is not
+// required to be commutative, measures are always combined from left to right
+//
+// if Type is an empty type no storage is used for it and no measure is
+// computed, which is the case for the default Unit measure
+//
+// a measure may additionally name the thread policy of the trees using it
+// (see src/utils/thread_policy.hpp), otherwise they use thread_policy::Shared
+//
+//   using ThreadPolicy = ...;
+//
+// and the comparator the keys are ordered by (see src/utils/compare.hpp),
+// otherwise keys are compared by compare::ThreeWay<K>
+//
+//   using Compare = ...;
+
+#include "src/utils/compare.hpp"
+#include "src/utils/thread_policy.hpp"
+
+#include <optional>
+#include <type_traits>
+
+namespace collections::finger_tree::measure {
+  // the trivial measure, this is the default and costs nothing
+  template<typename K, typename V>
+  struct Unit {
+    struct Type {};
+
+    static auto identity() -> Type { return Type{}; }
+    static auto combine(Type const&, Type const&) -> Type { return Type{}; }
+    static auto measure(K const&, V const&) -> Type { return Type{}; }
+  };
+
+  // the maximum value in a tree, this turns a finger tree into a priority
+  // queue, the maximum is found in O(log(n)) using FingerTree::split_by
+  template<typename K, typename V>
+  struct MaxValue {
+    using Type = std::optional<V>;
+
+    static auto identity() -> Type { return Type(); }
+
+    static auto combine(Type const& a, Type const& b) -> Type {
+      if (!a) {
+        return b;
+      }
+
+      if (!b) {
+        return a;
+      }
+
+      return *a >= *b ? a : b;
+    }
+
+    static auto measure(K const&, V const& val) -> Type { return Type(val); }
+  };
+
+  // the given measure for trees which never leave the thread they were
+  // created on, see thread_policy::Local
+  template<typename M>
+  struct Local : M {
+    using ThreadPolicy = thread_policy::Local;
+  };
+
+  // the given measure for trees whose keys are ordered by the comparator C
+  template<typename M, typename C>
+  struct Ordered : M {
+    using Compare = C;
+  };
+
+  // the thread policy of trees using the given measure
+  template<typename M, typename = void>
+  struct ThreadPolicyOf {
+    using Type = thread_policy::Shared;
+  };
+
+  template<typename M>
+  struct ThreadPolicyOf<M, std::void_t<typename M::ThreadPolicy>> {
+    using Type = typename M::ThreadPolicy;
+  };
+
+  // the comparator of trees with the given key type using the given measure
+  template<typename K, typename M, typename = void>
+  struct CompareOf {
+    using Type = compare::ThreeWay<K>;
+  };
+
+  template<typename K, typename M>
+  struct CompareOf<K, M, std::void_t<typename M::Compare>> {
+    using Type = typename M::Compare;
+  };
+
+  // compare two keys of a tree using the given measure, see CompareOf
+  template<typename K, typename M, typename A, typename B>
+  auto compare(A const& a, B const& b) {
+    return typename CompareOf<K, M>::Type()(a, b);
+  }
+}
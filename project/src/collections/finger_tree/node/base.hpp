@@ -1,27 +1,39 @@
 #pragma once
 
 // the base type of the node variants
+//
+// the variants have no virtual methods, the wrapper type knows which variant
+// it points to from the tag of its pointer and dispatches on it
 
+#include "src/collections/finger_tree/measure.hpp"
 #include "src/collections/finger_tree/node/core.hpp"
 
-#include <iostream>
-#include <sys/types.h>
+#include <cstddef>
 
 namespace collections::finger_tree::node {
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class NodeBase {
     // constructors
     protected:
       NodeBase() = default;
 
-    // helpers
+    // allocation
     public:
-      // print a debug representation of the node with the given indent
-      virtual auto show(std::ostream& os, uint indent) const -> std::ostream& = 0;
-  };
+      // NOTE: the variants are always deleted as their own type, so the size
+      // passed here is the one they were allocated with
+      static auto operator new(std::size_t size) -> void* {
+        return measure::ThreadPolicyOf<M>::Type::allocate(size);
+      }
+
+      static auto operator delete(void* ptr, std::size_t size) -> void {
+        measure::ThreadPolicyOf<M>::Type::deallocate(ptr, size);
+      }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, NodeBase<K, V> const& node) {
-    return node.show(os, 0);
-  }
+    private:
+      // the number of Node instances referring to this variant
+      typename measure::ThreadPolicyOf<M>::Type::RefCount _refs;
+
+      // give the wrapper type access to the reference count
+      friend class Node<K, V, M>;
+  };
 }
@@ -3,17 +3,26 @@
 // forward delarations
 
 namespace collections::finger_tree::node {
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class NodeDeep;
 
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class NodeLeaf;
 
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class NodeBase;
 
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class Node;
 
+  template<typename K, typename V, typename M>
+  struct Inserted;
+
+  template<typename K, typename V, typename M>
+  struct Removed;
+
+  template<typename K, typename V, typename M>
+  struct RemovedRun;
+
   enum class Kind { Leaf, Deep };
 }
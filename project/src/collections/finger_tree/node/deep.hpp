@@ -2,6 +2,8 @@
 
 // the internal node varaint, can contain 2 or 3 children
 
+#include "src/utils/key_search.hpp"
+
 #include "src/collections/finger_tree/node/core.hpp"
 
 #include <optional>
@@ -9,11 +11,12 @@
 #include <span>
 #include <string>
 #include <sys/types.h>
-#include <vector>
+#include <type_traits>
+#include <utility>
 
 namespace collections::finger_tree::node {
-  template<typename K, typename V>
-  class NodeDeep : public NodeBase<K, V> {
+  template<typename K, typename V, typename M>
+  class NodeDeep : public NodeBase<K, V, M> {
     // constructors
     public:
       NodeDeep() = delete;
@@ -21,81 +24,244 @@ namespace collections::finger_tree::node {
       // create a 2- or 3-node from the given nodes
       //
       // these nods must have the same depth
-      NodeDeep(Node<K, V> const& a, Node<K, V> const& b);
-      NodeDeep(Node<K, V> const& a, Node<K, V> const& b, Node<K, V> const& c);
+      NodeDeep(Node<K, V, M> const& a, Node<K, V, M> const& b);
+      NodeDeep(Node<K, V, M> const& a, Node<K, V, M> const& b, Node<K, V, M> const& c);
 
     // accessors
     public:
-      auto size() const -> bool { return this->_size; }
-      auto key() const -> bool { return this->_key; }
+      auto size() const -> uint { return this->_size; }
+      auto key() const -> K const& { return this->_key; }
+      auto measure() const -> typename M::Type const& { return this->_measure; }
 
-      auto is_two() const -> bool { return this->children().size() == 2; }
-      auto is_three() const -> bool { return this->children().size() == 3; }
+      auto is_two() const -> bool { return this->_count == 2; }
+      auto is_three() const -> bool { return this->_count == 3; }
 
-      auto children() const -> std::span<Node<K, V> const> {
-        return std::span(this->_children);
+      auto children() const -> std::span<Node<K, V, M> const> {
+        return std::span(this->_children, this->_count);
       }
 
     // methods
     public:
+      // return the index of the first child whose key is not less than the
+      // given key, or the number of children if there is none
+      template<typename Q>
+      auto find(Q const& key) const -> uint;
+
       // split the node similar to a finger tree, but only do a shallow split
       //
       // because this may return empty spans and is used to create new trees,
       // the deep_smart construtor helper is needed for finger trees
-      auto split(K const& key) const -> std::tuple<
-        std::span<Node<K, V> const>,
-        std::optional<Node<K, V>>,
-        std::span<Node<K, V> const>
+      template<typename Q>
+      auto split(Q const& key) const -> std::tuple<
+        std::span<Node<K, V, M> const>,
+        std::optional<Node<K, V, M>>,
+        std::span<Node<K, V, M> const>
+      >;
+
+      // split the node at the child containing the key value pair at the given
+      // index, the index must be less than the size of this node
+      auto split_at(uint index) const -> std::tuple<
+        std::span<Node<K, V, M> const>,
+        std::optional<Node<K, V, M>>,
+        std::span<Node<K, V, M> const>
+      >;
+
+      // split the node at the first child at which the given predicate becomes
+      // true for the measure accumulated from the left, starting at acc, see
+      // FingerTree::split_by
+      template<typename P>
+      auto split_by(P const& pred, typename M::Type const& acc) const -> std::tuple<
+        std::span<Node<K, V, M> const>,
+        std::optional<Node<K, V, M>>,
+        std::span<Node<K, V, M> const>
       >;
 
     // helpers
     protected:
       // print a debug representation of the node with the given indent
-      virtual auto show(std::ostream& os, uint indent) const -> std::ostream& override;
+      auto show(std::ostream& os, uint indent) const -> std::ostream&;
+
+    private:
+      // insert a child at the given index, there must be less than three
+      auto insert_child(uint index, Node<K, V, M> const& child) -> void;
+
+      // remove the child at the given index
+      auto erase_child(uint index) -> void;
+
+      // recompute the cached size, key and measure after the children were modified
+      // in place
+      auto update() -> void;
 
     private:
       // we cache both the key and the size, otherwise we would recurse all the way down the tree
       // when collecting them on demand
       uint _size;
       K _key;
-      std::vector<Node<K, V>> _children;
+
+      // the measure of all children, this takes no space for empty measures
+      [[no_unique_address]] typename M::Type _measure;
+
+      // the children are stored inline, the slots after _count are
+      // uninitialized nodes
+      uint _count;
+      Node<K, V, M> _children[3];
+
+      // the keys of the children, so finding a child doesn't read every
+      // candidate, this is empty unless the keys are searched vectorized
+      using Keys = key_search::InlineKeys<K, typename measure::CompareOf<K, M>::Type, 4>;
+      [[no_unique_address]] Keys _keys;
 
       // give the wrapper type access to this variant's internals
-      friend class Node<K, V>;
+      friend class Node<K, V, M>;
   };
 
-  template<typename K, typename V>
-  NodeDeep<K, V>::NodeDeep(
-    Node<K, V> const& a,
-    Node<K, V> const& b
-  ) : _size(a.size() + b.size()), _key(b.key()), _children() {
-    this->_children.reserve(2);
-    this->_children.emplace_back(a);
-    this->_children.emplace_back(b);
+  template<typename K, typename V, typename M>
+  NodeDeep<K, V, M>::NodeDeep(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b
+  ) : _size(a.size() + b.size()),
+    _key(b.key()),
+    _measure(M::combine(a.measure(), b.measure())),
+    _count(2),
+    _children{a, b, Node<K, V, M>()} {
+    this->_keys.set(0, a);
+    this->_keys.set(1, b);
+  }
+
+  template<typename K, typename V, typename M>
+  NodeDeep<K, V, M>::NodeDeep(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b,
+    Node<K, V, M> const& c
+  ) : _size(a.size() + b.size() + c.size()),
+    _key(c.key()),
+    _measure(M::combine(M::combine(a.measure(), b.measure()), c.measure())),
+    _count(3),
+    _children{a, b, c} {
+    this->_keys.set(0, a);
+    this->_keys.set(1, b);
+    this->_keys.set(2, c);
+  }
+
+  template<typename K, typename V, typename M>
+  auto NodeDeep<K, V, M>::insert_child(uint index, Node<K, V, M> const& child) -> void {
+    for (uint i = this->_count; i > index; i--) {
+      this->_children[i] = std::move(this->_children[i - 1]);
+    }
+
+    this->_children[index] = child;
+    this->_keys.insert(index, this->_count, child);
+    this->_count++;
+  }
+
+  template<typename K, typename V, typename M>
+  auto NodeDeep<K, V, M>::erase_child(uint index) -> void {
+    for (uint i = index; i + 1 < this->_count; i++) {
+      this->_children[i] = std::move(this->_children[i + 1]);
+    }
+
+    this->_keys.erase(index, this->_count);
+    this->_count--;
+    this->_children[this->_count] = Node<K, V, M>();
+  }
+
+  template<typename K, typename V, typename M>
+  auto NodeDeep<K, V, M>::update() -> void {
+    this->_size = 0;
+    this->_measure = M::identity();
+    for (uint i = 0; i < this->_count; i++) {
+      const auto& child = this->_children[i];
+      this->_size += child.size();
+      this->_measure = M::combine(this->_measure, child.measure());
+      this->_keys.set(i, child);
+    }
+
+    this->_key = this->_children[this->_count - 1].key();
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto NodeDeep<K, V, M>::find(Q const& key) const -> uint {
+    if constexpr (Keys::IS_ENABLED && std::is_same_v<Q, K>) {
+      return this->_keys.lower_bound(key);
+    } else {
+      uint i = 0;
+      while (i < this->_count && measure::compare<K, M>(this->_children[i].key(), key) < 0) {
+        i++;
+      }
+
+      return i;
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto NodeDeep<K, V, M>::split(Q const& key) const -> std::tuple<
+    std::span<Node<K, V, M> const>,
+    std::optional<Node<K, V, M>>,
+    std::span<Node<K, V, M> const>
+  > {
+    std::span<Node<K, V, M> const> nodes = this->children();
+
+    uint i = this->find(key);
+    if (i == nodes.size()) {
+      return std::tuple(
+        nodes,
+        std::optional<Node<K, V, M>>(),
+        std::span<Node<K, V, M> const>()
+      );
+    }
+
+    return std::tuple(
+      nodes.subspan(0, i),
+      std::optional(nodes[i]),
+      nodes.subspan(i + 1)
+    );
   }
 
-  template<typename K, typename V>
-  NodeDeep<K, V>::NodeDeep(
-    Node<K, V> const& a,
-    Node<K, V> const& b,
-    Node<K, V> const& c
-  ) : _size(a.size() + b.size() + c.size()), _key(c.key()), _children() {
-    this->_children.reserve(3);
-    this->_children.emplace_back(a);
-    this->_children.emplace_back(b);
-    this->_children.emplace_back(c);
+  template<typename K, typename V, typename M>
+  auto NodeDeep<K, V, M>::split_at(uint index) const -> std::tuple<
+    std::span<Node<K, V, M> const>,
+    std::optional<Node<K, V, M>>,
+    std::span<Node<K, V, M> const>
+  > {
+    std::span<Node<K, V, M> const> nodes = this->children();
+
+    for (uint i = 0; i < nodes.size(); i++) {
+      if (index < nodes[i].size()) {
+        return std::tuple(
+          nodes.subspan(0, i),
+          std::optional(nodes[i]),
+          nodes.subspan(i + 1)
+        );
+      }
+
+      index -= nodes[i].size();
+    }
+
+    return std::tuple(
+      nodes,
+      std::optional<Node<K, V, M>>(),
+      std::span<Node<K, V, M> const>()
+    );
   }
 
-  template<typename K, typename V>
-  auto NodeDeep<K, V>::split(K const& key) const -> std::tuple<
-    std::span<Node<K, V> const>,
-    std::optional<Node<K, V>>,
-    std::span<Node<K, V> const>
+  template<typename K, typename V, typename M>
+  template<typename P>
+  auto NodeDeep<K, V, M>::split_by(
+    P const& pred,
+    typename M::Type const& acc
+  ) const -> std::tuple<
+    std::span<Node<K, V, M> const>,
+    std::optional<Node<K, V, M>>,
+    std::span<Node<K, V, M> const>
   > {
-    std::span<Node<K, V> const> nodes = this->children();
+    std::span<Node<K, V, M> const> nodes = this->children();
 
+    auto current = acc;
     for (uint i = 0; i < nodes.size(); i++) {
-      if (nodes[i].key() >= key) {
+      current = M::combine(current, nodes[i].measure());
+      if (pred(current)) {
         return std::tuple(
           nodes.subspan(0, i),
           std::optional(nodes[i]),
@@ -106,19 +272,19 @@ namespace collections::finger_tree::node {
 
     return std::tuple(
       nodes,
-      std::optional<Node<K, V>>(),
-      std::span<Node<K, V> const>()
+      std::optional<Node<K, V, M>>(),
+      std::span<Node<K, V, M> const>()
     );
   }
- 
 
-  template<typename K, typename V>
-  auto NodeDeep<K, V>::show(std::ostream& os, uint indent) const -> std::ostream& {
+
+  template<typename K, typename V, typename M>
+  auto NodeDeep<K, V, M>::show(std::ostream& os, uint indent) const -> std::ostream& {
     auto istr = std::string(indent * 2, ' ');
     auto istr2 = std::string((indent + 1) * 2, ' ');
 
     os << "<" << std::endl;
-    for (const auto& child : this->_children) {
+    for (const auto& child : this->children()) {
       os << istr2;
       child.show(os, indent + 1);
       os << std::endl;
@@ -127,8 +293,8 @@ namespace collections::finger_tree::node {
     return os;
   }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, NodeDeep<K, V> const& node) {
+  template<typename K, typename V, typename M>
+  std::ostream& operator<<(std::ostream& os, NodeDeep<K, V, M> const& node) {
     return node.show(os, 0);
   }
 }
@@ -6,10 +6,12 @@
 
 #include <ostream>
 #include <sys/types.h>
+#include <tuple>
+#include <utility>
 
 namespace collections::finger_tree::node {
-  template<typename K, typename V>
-  class NodeLeaf : public NodeBase<K, V> {
+  template<typename K, typename V, typename M>
+  class NodeLeaf : public NodeBase<K, V, M> {
     // constructors
     public:
       NodeLeaf() = delete;
@@ -17,34 +19,53 @@ namespace collections::finger_tree::node {
       // create a leaf node with the given key and value
       NodeLeaf(K const& key, V const& val);
 
+      // create a leaf node with the given key and a value constructed in
+      // place from the given arguments
+      template<typename... Args>
+      NodeLeaf(std::in_place_t, K&& key, Args&&... args);
+
     // accessors
     public:
-      auto key() const -> K const& { return this->_key; }
-      auto val() const -> V const& { return this->_val; }
+      auto key() const -> K const& { return this->_pair.first; }
+      auto val() const -> V const& { return this->_pair.second; }
+
+      // the key and value as a pair, iterators refer to this
+      auto pair() const -> std::pair<K, V> const& { return this->_pair; }
 
     // helpers
     protected:
       // print a debug representation of the node with the given indent
-      virtual auto show(std::ostream& os, uint indent) const -> std::ostream& override;
+      auto show(std::ostream& os, uint indent) const -> std::ostream&;
 
     private:
-      K _key;
-      V _val;
+      std::pair<K, V> _pair;
 
       // give the wrapper type access to this variant's internals
-      friend class Node<K, V>;
+      friend class Node<K, V, M>;
   };
 
-  template<typename K, typename V>
-  NodeLeaf<K, V>::NodeLeaf(K const& key, V const& val) : _key(key), _val(val) {}
+  template<typename K, typename V, typename M>
+  NodeLeaf<K, V, M>::NodeLeaf(K const& key, V const& val) : _pair(key, val) {}
+
+  template<typename K, typename V, typename M>
+  template<typename... Args>
+  NodeLeaf<K, V, M>::NodeLeaf(
+    std::in_place_t,
+    K&& key,
+    Args&&... args
+  ) : _pair(
+    std::piecewise_construct,
+    std::forward_as_tuple(std::move(key)),
+    std::forward_as_tuple(std::forward<Args>(args)...)
+  ) {}
 
-  template<typename K, typename V>
-  auto NodeLeaf<K, V>::show(std::ostream& os, uint) const -> std::ostream& {
-    return os << "<" << this->_key << ":" << this->_val << ">";
+  template<typename K, typename V, typename M>
+  auto NodeLeaf<K, V, M>::show(std::ostream& os, uint) const -> std::ostream& {
+    return os << "<" << this->_pair.first << ":" << this->_pair.second << ">";
   }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, NodeLeaf<K, V> const& node) {
+  template<typename K, typename V, typename M>
+  std::ostream& operator<<(std::ostream& os, NodeLeaf<K, V, M> const& node) {
     return node.show(os, 0);
   }
 }
@@ -2,77 +2,212 @@
 
 // the wrapper for managing node persistence and the public interface
 
+#include "src/utils/reclaimer.hpp"
+#include "src/utils/scratch_arena.hpp"
+#include "src/utils/tagged_ptr.hpp"
 #include "src/utils/uninit_exception.hpp"
 #include "src/utils/variant_exception.hpp"
 
+#include "src/collections/finger_tree/core.hpp"
 #include "src/collections/finger_tree/node/core.hpp"
 #include "src/collections/finger_tree/node/base.hpp"
 #include "src/collections/finger_tree/node/deep.hpp"
 #include "src/collections/finger_tree/node/leaf.hpp"
 
+#include <algorithm>
 #include <ostream>
 #include <memory>
+#include <optional>
 #include <span>
+#include <stdexcept>
 #include <sys/types.h>
+#include <type_traits>
 #include <vector>
 
 namespace collections::finger_tree::node {
-  template<typename K, typename V>
+  template<typename K, typename V, typename M>
   class Node {
     // constructors
     public:
-      Node() = delete;
-
       // create a node for the given variant
-      Node(NodeDeep<K, V> const& deep);
-      Node(NodeLeaf<K, V> const& leaf);
+      Node(NodeDeep<K, V, M> const& deep);
+      Node(NodeLeaf<K, V, M> const& leaf);
 
       // create a leaf node for the given key and value
       Node(K const& key, V const& val);
 
+      // create a leaf node for the given key and a value constructed in place
+      // from the given arguments
+      template<typename... Args>
+      Node(std::in_place_t, K&& key, Args&&... args);
+
       // create a 2- or 3-node from the given nodes
       //
       // these nods must have the same depth
-      Node(Node<K, V> const& a, Node<K, V> const& b);
-      Node(Node<K, V> const& a, Node<K, V> const& b, Node<K, V> const& c);
+      Node(Node<K, V, M> const& a, Node<K, V, M> const& b);
+      Node(Node<K, V, M> const& a, Node<K, V, M> const& b, Node<K, V, M> const& c);
+
+      Node(Node<K, V, M> const& other);
+      Node(Node<K, V, M>&& other);
+      ~Node();
+
+      auto operator=(Node<K, V, M> const& other) -> Node<K, V, M>&;
+      auto operator=(Node<K, V, M>&& other) -> Node<K, V, M>&;
+
+      // create an uninitialized node, this is only used for the unused slots
+      // of deep nodes and digits which store their nodes inline
+      Node();
 
     // accessors
     public:
-      auto kind() const -> Kind { return this->_kind; }
+      auto kind() const -> Kind { return static_cast<Kind>(this->_repr.tag() - 1); }
       auto size() const -> uint;
       auto key() const -> K const&;
 
+      // return the measure of all leaves in this node, see measure.hpp
+      auto measure() const -> typename M::Type;
+
     // methods
     public:
       // return a pointer to the value this key refers to, or a nullptr if the
       // key didn't exist
-      auto get(K const& key) const -> V const*;
+      template<typename Q>
+      auto get(Q const& key) const -> V const*;
+
+      // return the key value pair at the given index, the index must be less
+      // than the size of this node
+      auto at(uint index) const -> std::pair<K const&, V const&>;
+
+      // return the number of keys in this node which are less than the given
+      // key
+      template<typename Q>
+      auto rank(Q const& key) const -> uint;
+
+      // insert the given leaf into this node, nodes on the path to the
+      // affected leaf are modified in place if they are uniquely owned and
+      // copied otherwise
+      //
+      // if a node already contains three children and one of them overflows
+      // it is split into two 2-nodes
+      auto insert(K const& key, Node<K, V, M> const& leaf) -> Inserted<K, V, M>;
+
+      // remove the leaf with the given key from this node, nodes on the path
+      // to the affected leaf are modified in place if they are uniquely owned
+      // and copied otherwise
+      //
+      // if a node is left with only one child it is dissolved and its child is
+      // returned so the parent can merge it into a sibling
+      auto remove(K const& key) -> Removed<K, V, M>;
+
+      // merge a node of one level less depth into the given side of this deep
+      // node, returning one or two nodes in key order
+      auto merge(
+        Direction dir,
+        Node<K, V, M> const& underflow
+      ) const -> std::pair<Node<K, V, M>, std::optional<Node<K, V, M>>>;
+
+      // attach a node of any depth less than that of this node's children to
+      // the given side of this node, which is depth levels above its leaves,
+      // returning one or two nodes of this node's depth in key order
+      auto attach(
+        Direction dir,
+        Node<K, V, M> const& node,
+        uint depth,
+        uint node_depth
+      ) const -> std::pair<Node<K, V, M>, std::optional<Node<K, V, M>>>;
+
+      // insert the given leaves into this node and append the nodes replacing
+      // it to out, returning the number of keys which didn't exist before
+      //
+      // the leaves must be sorted by key with unique keys, each child is
+      // visited once with the run of leaves which would be found in it, so
+      // every node on the paths to them is copied once, no matter how many of
+      // the leaves end up below it, untouched children are shared
+      //
+      // the temporaries of the whole descent live in the scratch arena, so
+      // this must be called inside a ScratchArena::Scope, no scopes are opened
+      // below it, as out may grow at any level
+      auto insert_run(
+        std::span<Node<K, V, M> const> leaves,
+        ScratchVector<Node<K, V, M>>& out
+      ) const -> uint;
+
+      // remove the given keys from this node, which is depth levels above its
+      // leaves, see insert_run
+      //
+      // unlike remove, children which are left with too few leaves can't
+      // always be merged into a sibling of the same depth, so the result may
+      // be a node of any lesser depth, which the parent attaches to one of its
+      // other children
+      auto remove_run(std::span<K const> keys, uint depth) const -> RemovedRun<K, V, M>;
+
+      // return the key value pair or value of this leaf, they're moved out if
+      // no other node refers to this leaf and copied otherwise, so this node
+      // must be dropped afterwards
+      auto take_pair() -> std::pair<K, V>;
+      auto take_val() -> V;
 
     // helpers
     public:
-      // pack nodes in the given span into new deep nodes
+      // pack nodes in the given span into new deep nodes, the result lives in
+      // the scratch arena, so this must be called inside a ScratchArena::Scope
       static auto pack_nodes(
-        std::span<Node<K, V> const> nodes
-      ) -> std::vector<Node<K, V>>;
+        std::span<Node<K, V, M> const> nodes
+      ) -> ScratchVector<Node<K, V, M>>;
+
+      // join two adjacent nodes of the given depths into one node, which is
+      // as deep as the deeper of them or one level deeper
+      static auto join(
+        std::pair<Node<K, V, M>, uint> const& left,
+        std::pair<Node<K, V, M>, uint> const& right
+      ) -> std::pair<Node<K, V, M>, uint>;
+
+      // attach the given nodes which are less deep than depth to their
+      // neighbours and append the resulting nodes of the given depth to out,
+      // if there is no node of that depth to attach them to, they are joined
+      // and returned instead
+      static auto settle(
+        std::span<std::pair<Node<K, V, M>, uint> const> nodes,
+        uint depth,
+        ScratchVector<Node<K, V, M>>& out
+      ) -> std::optional<std::pair<Node<K, V, M>, uint>>;
+
+      // insert the given leaves into the given adjacent nodes, see insert_run,
+      // leaves greater than the key of the last node are inserted into it
+      static auto insert_runs(
+        std::span<Node<K, V, M> const> nodes,
+        std::span<Node<K, V, M> const> leaves,
+        ScratchVector<Node<K, V, M>>& out
+      ) -> uint;
+
+      // remove the given keys from the given adjacent nodes, which are depth
+      // levels above their leaves, and append what's left of each of them
+      // with its depth to out, see remove_run
+      static auto remove_runs(
+        std::span<Node<K, V, M> const> nodes,
+        std::span<K const> keys,
+        uint depth,
+        ScratchVector<std::pair<Node<K, V, M>, uint>>& out
+      ) -> uint;
 
     public:
-      auto is_uninit() const -> bool { return this->_repr == nullptr; }
-      auto is_leaf() const -> bool { return this->_kind == Kind::Leaf; }
-      auto is_deep() const -> bool { return this->_kind == Kind::Deep; }
+      auto is_uninit() const -> bool { return this->_repr.is_null(); }
+      auto is_leaf() const -> bool { return this->_repr.tag() == Node<K, V, M>::tag(Kind::Leaf); }
+      auto is_deep() const -> bool { return this->_repr.tag() == Node<K, V, M>::tag(Kind::Deep); }
 
-      auto as_leaf() const -> NodeLeaf<K, V> const& {
+      auto as_leaf() const -> NodeLeaf<K, V, M> const& {
         this->assert_init();
         if (this->is_leaf()) {
-          return *static_cast<NodeLeaf<K, V> const*>(this->_repr.get());
+          return *static_cast<NodeLeaf<K, V, M> const*>(this->_repr.ptr());
         } else {
           throw VariantException("Attmpted to get Leaf reference to Deep");
         }
       }
 
-      auto as_deep() const -> NodeDeep<K, V> const& {
+      auto as_deep() const -> NodeDeep<K, V, M> const& {
         this->assert_init();
         if (this->is_deep()) {
-          return *static_cast<NodeDeep<K, V> const*>(this->_repr.get());
+          return *static_cast<NodeDeep<K, V, M> const*>(this->_repr.ptr());
         } else {
           throw VariantException("Attmpted to get Deep reference to Leaf");
         }
@@ -81,49 +216,153 @@ namespace collections::finger_tree::node {
       // ensure we're initalized (not nullptr)
       auto assert_init() const -> void;
 
+      // ensure we're operating on a _repr instance which has no other
+      // referents, see FingerTree::ensure_unique
+      //
+      // NOTE: this only makes modifying this node safe if all nodes on the
+      // path to it were made unique before
+      auto ensure_unique() -> void;
+
       // print a debug representation of the node with the given indent
       auto show(std::ostream& os, uint indent) const -> std::ostream&;
 
     private:
-      Kind _kind;
-      std::shared_ptr<NodeBase<K, V>> _repr;
+      // mutable access to the deep variant, must only be used after
+      // ensure_unique
+      auto as_deep_mut() -> NodeDeep<K, V, M>& {
+        return *static_cast<NodeDeep<K, V, M>*>(this->_repr.ptr());
+      }
+
+    private:
+      // the pointer tag of each variant, zero is left for the uninitialized
+      // state
+      static constexpr auto tag(Kind kind) -> uint { return static_cast<uint>(kind) + 1; }
+
+      // add or drop a reference to the variant we point to, the last
+      // reference destroys it
+      auto acquire() const -> void;
+      auto release() -> void;
+
+    private:
+      // both variants are intrusively reference counted and the kind is
+      // stored in the pointer tag, so a node is a single pointer
+      TaggedPtr<NodeBase<K, V, M>> _repr;
+  };
+
+  // the result of an insert into a node, `overflow` is set if the node had to
+  // be split, it is the right sibling of the node inserted into
+  template<typename K, typename V, typename M>
+  struct Inserted {
+    std::optional<Node<K, V, M>> overflow;
+    std::optional<V> found;
   };
 
-  template<typename K, typename V>
-  Node<K, V>::Node(
-    NodeDeep<K, V> const& deep
-  ) : _kind(Kind::Deep), _repr(std::static_pointer_cast<NodeBase<K, V>>(
-    std::make_shared<NodeDeep<K, V>>(deep)
-  )) {}
-
-  template<typename K, typename V>
-  Node<K, V>::Node(
-    NodeLeaf<K, V> const& leaf
-  ) : _kind(Kind::Leaf), _repr(std::static_pointer_cast<NodeBase<K, V>>(
-    std::make_shared<NodeLeaf<K, V>>(leaf)
-  )) {}
-
-  template<typename K, typename V>
-  Node<K, V>::Node(
+  // the result of a remove from a node
+  // - if `erased` is not set the node is still valid
+  // - if `erased` and `underflow` are set the node was dissolved, this is its
+  //   only remaining child which must be merged into a sibling
+  // - if only `erased` is set the node was the removed leaf itself
+  template<typename K, typename V, typename M>
+  struct Removed {
+    bool erased;
+    std::optional<Node<K, V, M>> underflow;
+    std::optional<V> found;
+  };
+
+  // the result of removing a run of keys from a node, `count` is the number of
+  // keys which were removed
+  // - if `node` is not set, all leaves of the node were removed
+  // - if `depth` is the depth of the node, `node` replaces it
+  // - otherwise the node underflowed, `node` is all that's left of it and
+  //   must be attached to a sibling, see Node::attach
+  template<typename K, typename V, typename M>
+  struct RemovedRun {
+    std::optional<Node<K, V, M>> node;
+    uint depth;
+    uint count;
+  };
+
+  template<typename K, typename V, typename M>
+  Node<K, V, M>::Node() : _repr() {}
+
+  template<typename K, typename V, typename M>
+  Node<K, V, M>::Node(
+    NodeDeep<K, V, M> const& deep
+  ) : _repr(new NodeDeep<K, V, M>(deep), Node<K, V, M>::tag(Kind::Deep)) {}
+
+  template<typename K, typename V, typename M>
+  Node<K, V, M>::Node(
+    NodeLeaf<K, V, M> const& leaf
+  ) : _repr(new NodeLeaf<K, V, M>(leaf), Node<K, V, M>::tag(Kind::Leaf)) {}
+
+  // NOTE: the variants are constructed in place, going through the variant
+  // constructors above would copy them once more
+  template<typename K, typename V, typename M>
+  Node<K, V, M>::Node(
     const K& key,
     const V& val
-  ) : Node<K, V>(NodeLeaf<K, V>(key, val)) {}
-
-  template<typename K, typename V>
-  Node<K, V>::Node(
-    Node<K, V> const& a,
-    Node<K, V> const& b
-  ) : Node<K, V>(NodeDeep<K, V>(a, b)) {}
-  
-  template<typename K, typename V>
-  Node<K, V>::Node(
-    Node<K, V> const& a,
-    Node<K, V> const& b,
-    Node<K, V> const& c
-  ) : Node<K, V>(NodeDeep<K, V>(a, b, c)) {}
-
-  template<typename K, typename V>
-  auto Node<K, V>::size() const -> uint {
+  ) : _repr(new NodeLeaf<K, V, M>(key, val), Node<K, V, M>::tag(Kind::Leaf)) {}
+
+  template<typename K, typename V, typename M>
+  template<typename... Args>
+  Node<K, V, M>::Node(
+    std::in_place_t,
+    K&& key,
+    Args&&... args
+  ) : _repr(
+    new NodeLeaf<K, V, M>(std::in_place, std::move(key), std::forward<Args>(args)...),
+    Node<K, V, M>::tag(Kind::Leaf)
+  ) {}
+
+  template<typename K, typename V, typename M>
+  Node<K, V, M>::Node(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b
+  ) : _repr(new NodeDeep<K, V, M>(a, b), Node<K, V, M>::tag(Kind::Deep)) {}
+
+  template<typename K, typename V, typename M>
+  Node<K, V, M>::Node(
+    Node<K, V, M> const& a,
+    Node<K, V, M> const& b,
+    Node<K, V, M> const& c
+  ) : _repr(new NodeDeep<K, V, M>(a, b, c), Node<K, V, M>::tag(Kind::Deep)) {}
+
+  template<typename K, typename V, typename M>
+  Node<K, V, M>::Node(Node<K, V, M> const& other) : _repr(other._repr) {
+    this->acquire();
+  }
+
+  template<typename K, typename V, typename M>
+  Node<K, V, M>::Node(Node<K, V, M>&& other) : _repr(other._repr) {
+    other._repr = TaggedPtr<NodeBase<K, V, M>>();
+  }
+
+  template<typename K, typename V, typename M>
+  Node<K, V, M>::~Node() {
+    this->release();
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::operator=(Node<K, V, M> const& other) -> Node<K, V, M>& {
+    // NOTE: acquire first, the other node may be referred to by this one
+    other.acquire();
+    this->release();
+    this->_repr = other._repr;
+    return *this;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::operator=(Node<K, V, M>&& other) -> Node<K, V, M>& {
+    // NOTE: detach first, the other node may be referred to by this one
+    auto repr = other._repr;
+    other._repr = TaggedPtr<NodeBase<K, V, M>>();
+    this->release();
+    this->_repr = repr;
+    return *this;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::size() const -> uint {
     this->assert_init();
 
     if (this->is_leaf()) {
@@ -134,47 +373,459 @@ namespace collections::finger_tree::node {
     return deep.size();
   }
 
-  template<typename K, typename V>
-  auto Node<K, V>::key() const -> const K& {
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::measure() const -> typename M::Type {
     this->assert_init();
 
     if (this->is_leaf()) {
       const auto& leaf = this->as_leaf();
-      return leaf._key;
+      return M::measure(leaf.key(), leaf.val());
     }
 
     const auto& deep = this->as_deep();
-    return deep._key;
+    return deep._measure;
   }
 
-  template<typename K, typename V>
-  auto Node<K, V>::get(K const& key) const -> V const* {
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::key() const -> const K& {
     this->assert_init();
 
     if (this->is_leaf()) {
       const auto& leaf = this->as_leaf();
-      if (leaf.key() == key) {
-        return &leaf._val;
-      } else {
+      return leaf.key();
+    }
+
+    const auto& deep = this->as_deep();
+    return deep._key;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::at(uint index) const -> std::pair<K const&, V const&> {
+    this->assert_init();
+
+    Node<K, V, M> const* node = this;
+    while (node->is_deep()) {
+      std::span<Node<K, V, M> const> children = node->as_deep().children();
+
+      // NOTE: the index is less than the size of the node, so the last child
+      // must contain it if no other does
+      uint i = 0;
+      while (i < children.size() - 1 && !(index < children[i].size())) {
+        index -= children[i].size();
+        i++;
+      }
+
+      node = &children[i];
+    }
+
+    const auto& leaf = node->as_leaf();
+    return std::pair<K const&, V const&>(leaf.key(), leaf.val());
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto Node<K, V, M>::rank(Q const& key) const -> uint {
+    this->assert_init();
+
+    uint rank = 0;
+    Node<K, V, M> const* node = this;
+    while (node->is_deep()) {
+      const auto& deep = node->as_deep();
+
+      // NOTE: keys greater than the key of this node are counted by the last
+      // child
+      uint i = std::min(deep.find(key), deep._count - 1);
+      for (uint j = 0; j < i; j++) {
+        rank += deep._children[j].size();
+      }
+
+      node = &deep._children[i];
+    }
+
+    return measure::compare<K, M>(node->as_leaf().key(), key) >= 0 ? rank : rank + 1;
+  }
+
+  template<typename K, typename V, typename M>
+  template<typename Q>
+  auto Node<K, V, M>::get(Q const& key) const -> V const* {
+    this->assert_init();
+
+    Node<K, V, M> const* node = this;
+    while (node->is_deep()) {
+      // NOTE: inline keys are compared all at once, there's nothing to gain
+      // from stopping early
+      if constexpr (NodeDeep<K, V, M>::Keys::IS_ENABLED && std::is_same_v<Q, K>) {
+        const auto& deep = node->as_deep();
+        uint i = deep.find(key);
+        if (i == deep._count) {
+          return nullptr;
+        }
+
+        node = &deep._children[i];
+        continue;
+      }
+
+      Node<K, V, M> const* next = nullptr;
+      for (const auto& child : node->as_deep().children()) {
+        auto order = measure::compare<K, M>(child.key(), key);
+
+        // NOTE: the key of a deep node is the key of its last leaf, so once
+        // it's equal no more keys need to be compared
+        if (order == 0) {
+          next = &child;
+          while (next->is_deep()) {
+            next = &next->as_deep().children().back();
+          }
+
+          return &next->as_leaf().val();
+        }
+
+        if (order > 0) {
+          next = &child;
+          break;
+        }
+      }
+
+      if (next == nullptr) {
         return nullptr;
       }
+
+      node = next;
     }
 
-    const auto& deep = this->as_deep();
-    for (const auto& child : deep.children()) {
-      if (child.key() >= key) {
-        return child.get(key);
+    const auto& leaf = node->as_leaf();
+    if (measure::compare<K, M>(leaf.key(), key) == 0) {
+      return &leaf.val();
+    } else {
+      return nullptr;
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::insert(
+    K const& key,
+    Node<K, V, M> const& leaf
+  ) -> Inserted<K, V, M> {
+    this->assert_init();
+
+    if (this->is_leaf()) {
+      auto order = measure::compare<K, M>(this->as_leaf().key(), key);
+      if (order == 0) {
+        std::optional<V> found = this->take_val();
+        *this = leaf;
+        return Inserted<K, V, M> { std::nullopt, std::move(found) };
+      }
+
+      // NOTE: keys greater than this node's key are only inserted on the very
+      // right of a tree
+      if (order > 0) {
+        Node<K, V, M> overflow = *this;
+        *this = leaf;
+        return Inserted<K, V, M> { overflow, std::nullopt };
+      } else {
+        return Inserted<K, V, M> { leaf, std::nullopt };
       }
     }
 
-    return nullptr;
+    this->ensure_unique();
+    auto& deep = this->as_deep_mut();
+    auto& children = deep._children;
+
+    uint i = std::min(deep.find(key), deep._count - 1);
+
+    auto inserted = children[i].insert(key, leaf);
+
+    std::optional<Node<K, V, M>> overflow;
+    if (inserted.overflow && deep._count < 3) {
+      deep.insert_child(i + 1, *inserted.overflow);
+    } else if (inserted.overflow) {
+      // there's no room for a fourth child, so we keep the left two and
+      // return the right two as a new sibling
+      if (i == 2) {
+        overflow = Node<K, V, M>(children[2], *inserted.overflow);
+      } else if (i == 1) {
+        overflow = Node<K, V, M>(*inserted.overflow, children[2]);
+      } else {
+        overflow = Node<K, V, M>(children[1], children[2]);
+        children[1] = *inserted.overflow;
+      }
+
+      deep.erase_child(2);
+    }
+
+    deep.update();
+    return Inserted<K, V, M> { overflow, std::move(inserted.found) };
   }
 
-  template<typename K, typename V>
-  auto Node<K, V>::pack_nodes(
-    std::span<Node<K, V> const> nodes
-  ) -> std::vector<Node<K, V>> {
-    std::vector<Node<K, V>> packed;
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::remove(K const& key) -> Removed<K, V, M> {
+    this->assert_init();
+
+    if (this->is_leaf()) {
+      if (measure::compare<K, M>(this->as_leaf().key(), key) == 0) {
+        // NOTE: the parent drops this leaf once it's erased
+        return Removed<K, V, M> { true, std::nullopt, this->take_val() };
+      }
+
+      return Removed<K, V, M> { false, std::nullopt, std::nullopt };
+    }
+
+    if (measure::compare<K, M>(this->key(), key) < 0) {
+      return Removed<K, V, M> { false, std::nullopt, std::nullopt };
+    }
+
+    // NOTE: the children must be unique before descending into them, even if
+    // the key turns out not to exist
+    this->ensure_unique();
+    auto& deep = this->as_deep_mut();
+    auto& children = deep._children;
+
+    uint i = deep.find(key);
+
+    auto removed = children[i].remove(key);
+    if (!removed.found) {
+      return Removed<K, V, M> { false, std::nullopt, std::nullopt };
+    }
+
+    if (removed.underflow) {
+      // the child was dissolved, merge its remaining child into a sibling
+      if (i > 0) {
+        auto [left, right] = children[i - 1].merge(Direction::Right, *removed.underflow);
+        children[i - 1] = left;
+        if (right) {
+          children[i] = *right;
+        } else {
+          deep.erase_child(i);
+        }
+      } else {
+        auto [left, right] = children[i + 1].merge(Direction::Left, *removed.underflow);
+        children[i] = left;
+        if (right) {
+          children[i + 1] = *right;
+        } else {
+          deep.erase_child(i + 1);
+        }
+      }
+    } else if (removed.erased) {
+      deep.erase_child(i);
+    }
+
+    if (deep._count == 1) {
+      return Removed<K, V, M> { true, children[0], std::move(removed.found) };
+    }
+
+    deep.update();
+    return Removed<K, V, M> { false, std::nullopt, std::move(removed.found) };
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::merge(
+    Direction dir,
+    Node<K, V, M> const& underflow
+  ) const -> std::pair<Node<K, V, M>, std::optional<Node<K, V, M>>> {
+    auto children = this->as_deep().children();
+
+    ScratchArena::Scope scope;
+    ScratchVector<Node<K, V, M>> nodes;
+    nodes.reserve(4);
+
+    if (dir == Direction::Left) {
+      nodes.emplace_back(underflow);
+    }
+
+    for (const auto& child : children) {
+      nodes.emplace_back(child);
+    }
+
+    if (dir == Direction::Right) {
+      nodes.emplace_back(underflow);
+    }
+
+    if (nodes.size() == 4) {
+      return std::pair(
+        Node<K, V, M>(nodes[0], nodes[1]),
+        std::optional(Node<K, V, M>(nodes[2], nodes[3]))
+      );
+    }
+
+    return std::pair(
+      Node<K, V, M>(nodes[0], nodes[1], nodes[2]),
+      std::optional<Node<K, V, M>>()
+    );
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::attach(
+    Direction dir,
+    Node<K, V, M> const& node,
+    uint depth,
+    uint node_depth
+  ) const -> std::pair<Node<K, V, M>, std::optional<Node<K, V, M>>> {
+    if (node_depth + 1 == depth) {
+      return this->merge(dir, node);
+    }
+
+    // descend along the given side until the node is as deep as the children
+    // there and replace the edge child with the one or two nodes it becomes
+    auto children = this->as_deep().children();
+    uint edge = dir == Direction::Left ? 0 : children.size() - 1;
+    auto [left, right] = children[edge].attach(dir, node, depth - 1, node_depth);
+
+    ScratchArena::Scope scope;
+    ScratchVector<Node<K, V, M>> nodes;
+    nodes.reserve(4);
+
+    for (uint i = 0; i < children.size(); i++) {
+      if (i != edge) {
+        nodes.emplace_back(children[i]);
+        continue;
+      }
+
+      nodes.emplace_back(left);
+      if (right) {
+        nodes.emplace_back(*right);
+      }
+    }
+
+    if (nodes.size() == 4) {
+      return std::pair(
+        Node<K, V, M>(nodes[0], nodes[1]),
+        std::optional(Node<K, V, M>(nodes[2], nodes[3]))
+      );
+    }
+
+    if (nodes.size() == 3) {
+      return std::pair(
+        Node<K, V, M>(nodes[0], nodes[1], nodes[2]),
+        std::optional<Node<K, V, M>>()
+      );
+    }
+
+    return std::pair(Node<K, V, M>(nodes[0], nodes[1]), std::optional<Node<K, V, M>>());
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::insert_run(
+    std::span<Node<K, V, M> const> leaves,
+    ScratchVector<Node<K, V, M>>& out
+  ) const -> uint {
+    this->assert_init();
+
+    if (this->is_leaf()) {
+      // NOTE: only the last leaf of a tree is given leaves with greater keys
+      // than its own
+      uint i = 0;
+      while (i < leaves.size() && measure::compare<K, M>(leaves[i].key(), this->key()) < 0) {
+        out.push_back(leaves[i]);
+        i++;
+      }
+
+      bool found = i < leaves.size() && measure::compare<K, M>(leaves[i].key(), this->key()) == 0;
+      out.push_back(found ? leaves[i] : *this);
+      if (found) {
+        i++;
+      }
+
+      out.insert(out.end(), leaves.begin() + i, leaves.end());
+      return leaves.size() - found;
+    }
+
+    ScratchVector<Node<K, V, M>> nodes;
+    nodes.reserve(3);
+
+    uint count = Node<K, V, M>::insert_runs(this->as_deep().children(), leaves, nodes);
+    if (nodes.size() == 2) {
+      out.emplace_back(nodes[0], nodes[1]);
+    } else if (nodes.size() == 3) {
+      out.emplace_back(nodes[0], nodes[1], nodes[2]);
+    } else {
+      auto packed = Node<K, V, M>::pack_nodes(nodes);
+      out.insert(out.end(), packed.begin(), packed.end());
+    }
+
+    return count;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::remove_run(
+    std::span<K const> keys,
+    uint depth
+  ) const -> RemovedRun<K, V, M> {
+    this->assert_init();
+
+    if (this->is_leaf()) {
+      bool found = std::binary_search(keys.begin(), keys.end(), this->key(), [](auto const& a, auto const& b) {
+        return measure::compare<K, M>(a, b) < 0;
+      });
+
+      if (found) {
+        return RemovedRun<K, V, M> { std::nullopt, 0, 1 };
+      }
+
+      return RemovedRun<K, V, M> { *this, 0, 0 };
+    }
+
+    ScratchArena::Scope scope;
+    ScratchVector<std::pair<Node<K, V, M>, uint>> children;
+    children.reserve(3);
+
+    uint count = Node<K, V, M>::remove_runs(this->as_deep().children(), keys, depth - 1, children);
+    if (count == 0) {
+      return RemovedRun<K, V, M> { *this, depth, 0 };
+    }
+
+    // NOTE: attaching underflowed children never leaves more nodes than there
+    // were children
+    ScratchVector<Node<K, V, M>> nodes;
+    nodes.reserve(3);
+
+    auto rest = Node<K, V, M>::settle(children, depth - 1, nodes);
+    switch (nodes.size()) {
+      case 0:
+        if (rest) {
+          return RemovedRun<K, V, M> { rest->first, rest->second, count };
+        }
+
+        return RemovedRun<K, V, M> { std::nullopt, 0, count };
+      case 1:
+        return RemovedRun<K, V, M> { nodes[0], depth - 1, count };
+      case 2:
+        return RemovedRun<K, V, M> { Node<K, V, M>(nodes[0], nodes[1]), depth, count };
+      default:
+        return RemovedRun<K, V, M> { Node<K, V, M>(nodes[0], nodes[1], nodes[2]), depth, count };
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::take_pair() -> std::pair<K, V> {
+    const auto& leaf = this->as_leaf();
+
+    // NOTE: see FingerTree::ensure_unique for the threading rules
+    if (this->_repr.ptr()->_refs.is_unique()) {
+      return std::move(const_cast<NodeLeaf<K, V, M>&>(leaf)._pair);
+    }
+
+    return leaf.pair();
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::take_val() -> V {
+    const auto& leaf = this->as_leaf();
+
+    // NOTE: see take_pair
+    if (this->_repr.ptr()->_refs.is_unique()) {
+      return std::move(const_cast<NodeLeaf<K, V, M>&>(leaf)._pair.second);
+    }
+
+    return leaf.val();
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::pack_nodes(
+    std::span<Node<K, V, M> const> nodes
+  ) -> ScratchVector<Node<K, V, M>> {
+    ScratchVector<Node<K, V, M>> packed;
+    packed.reserve(nodes.size() / 3 + 1);
 
     while (nodes.size() != 0) {
       switch (nodes.size()) {
@@ -201,24 +852,197 @@ namespace collections::finger_tree::node {
     return packed;
   }
 
-  template<typename K, typename V>
-  auto Node<K, V>::assert_init() const -> void {
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::join(
+    std::pair<Node<K, V, M>, uint> const& left,
+    std::pair<Node<K, V, M>, uint> const& right
+  ) -> std::pair<Node<K, V, M>, uint> {
+    const auto& [a, a_depth] = left;
+    const auto& [b, b_depth] = right;
+
+    if (a_depth == b_depth) {
+      return std::pair(Node<K, V, M>(a, b), a_depth + 1);
+    }
+
+    uint depth = std::max(a_depth, b_depth);
+    auto [first, second] = a_depth > b_depth
+      ? a.attach(Direction::Right, b, a_depth, b_depth)
+      : b.attach(Direction::Left, a, b_depth, a_depth);
+
+    if (second) {
+      return std::pair(Node<K, V, M>(first, *second), depth + 1);
+    }
+
+    return std::pair(first, depth);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::settle(
+    std::span<std::pair<Node<K, V, M>, uint> const> nodes,
+    uint depth,
+    ScratchVector<Node<K, V, M>>& out
+  ) -> std::optional<std::pair<Node<K, V, M>, uint>> {
+    uint first = out.size();
+
+    // shallower nodes are attached to the node of the given depth before
+    // them, until there is one they're joined and attached to the next one
+    std::optional<std::pair<Node<K, V, M>, uint>> pending;
+    for (const auto& [node, node_depth] : nodes) {
+      if (node_depth == depth) {
+        if (!pending) {
+          out.push_back(node);
+          continue;
+        }
+
+        auto [left, right] = node.attach(Direction::Left, pending->first, depth, pending->second);
+        out.push_back(left);
+        if (right) {
+          out.push_back(*right);
+        }
+
+        pending.reset();
+      } else if (out.size() > first) {
+        auto [left, right] = out.back().attach(Direction::Right, node, depth, node_depth);
+        out.back() = left;
+        if (right) {
+          out.push_back(*right);
+        }
+      } else if (pending) {
+        pending = Node<K, V, M>::join(*pending, std::pair(node, node_depth));
+        if (pending->second == depth) {
+          out.push_back(pending->first);
+          pending.reset();
+        }
+      } else {
+        pending = std::pair(node, node_depth);
+      }
+    }
+
+    return pending;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::insert_runs(
+    std::span<Node<K, V, M> const> nodes,
+    std::span<Node<K, V, M> const> leaves,
+    ScratchVector<Node<K, V, M>>& out
+  ) -> uint {
+    uint count = 0;
+    for (uint i = 0; i < nodes.size(); i++) {
+      uint run = leaves.size();
+      if (i + 1 < nodes.size()) {
+        run = std::partition_point(leaves.begin(), leaves.end(), [&](auto const& leaf) {
+          return measure::compare<K, M>(leaf.key(), nodes[i].key()) <= 0;
+        }) - leaves.begin();
+      }
+
+      if (run == 0) {
+        out.push_back(nodes[i]);
+      } else {
+        count += nodes[i].insert_run(leaves.subspan(0, run), out);
+      }
+
+      leaves = leaves.subspan(run);
+    }
+
+    return count;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::remove_runs(
+    std::span<Node<K, V, M> const> nodes,
+    std::span<K const> keys,
+    uint depth,
+    ScratchVector<std::pair<Node<K, V, M>, uint>>& out
+  ) -> uint {
+    uint count = 0;
+    for (uint i = 0; i < nodes.size(); i++) {
+      uint run = keys.size();
+      if (i + 1 < nodes.size()) {
+        run = std::partition_point(keys.begin(), keys.end(), [&](auto const& key) {
+          return measure::compare<K, M>(key, nodes[i].key()) <= 0;
+        }) - keys.begin();
+      }
+
+      auto removed = run == 0
+        ? RemovedRun<K, V, M> { nodes[i], depth, 0 }
+        : nodes[i].remove_run(keys.subspan(0, run), depth);
+
+      if (removed.node) {
+        out.emplace_back(*removed.node, removed.depth);
+      }
+
+      count += removed.count;
+      keys = keys.subspan(run);
+    }
+
+    return count;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::assert_init() const -> void {
     if (this->is_uninit()) {
       throw UninitException("Node is uninitialized");
     }
   }
 
-  template<typename K, typename V>
-  auto Node<K, V>::show(std::ostream& os, uint indent) const -> std::ostream& {
-    if (this->_repr == nullptr) {
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::ensure_unique() -> void {
+    this->assert_init();
+
+    // NOTE: see FingerTree::ensure_unique for the threading rules
+    if (this->_repr.ptr()->_refs.is_unique()) {
+      return;
+    }
+
+    if (this->is_leaf()) {
+      *this = Node<K, V, M>(this->as_leaf());
+    } else {
+      *this = Node<K, V, M>(this->as_deep());
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::acquire() const -> void {
+    if (!this->is_uninit()) {
+      this->_repr.ptr()->_refs.acquire();
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::release() -> void {
+    if (this->is_uninit() || !this->_repr.ptr()->_refs.release()) {
+      return;
+    }
+
+    // NOTE: the variants have no virtual destructor, so we delete them as
+    // their concrete type, leaves have no children, so deferring them would
+    // only add overhead
+    if (this->is_leaf()) {
+      delete static_cast<NodeLeaf<K, V, M>*>(this->_repr.ptr());
+    } else {
+      Reclaimer::dispose(
+        &this->as_deep_mut(),
+        measure::ThreadPolicyOf<M>::Type::IS_LOCAL
+      );
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Node<K, V, M>::show(std::ostream& os, uint indent) const -> std::ostream& {
+    if (this->is_uninit()) {
       return os << "null";
     }
 
-    return this->_repr->show(os, indent);
+    if (this->is_leaf()) {
+      return this->as_leaf().show(os, indent);
+    }
+
+    return this->as_deep().show(os, indent);
   }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, Node<K, V> const& node) {
+  template<typename K, typename V, typename M>
+  std::ostream& operator<<(std::ostream& os, Node<K, V, M> const& node) {
     return node.show(os, 0);
   }
 }
@@ -7,44 +7,44 @@
 #include <sys/types.h>
 
 namespace collections::finger_tree {
-  template<typename K, typename V>
-  class FingerTreeSingle : public FingerTreeBase<K, V> {
+  template<typename K, typename V, typename M>
+  class FingerTreeSingle : public FingerTreeBase<K, V, M> {
     // constructors
     public:
-      FingerTreeSingle(const Node<K, V>& node);
+      FingerTreeSingle(const Node<K, V, M>& node);
 
     // accessors
     public:
       auto key() const -> const K& { return this->_node.key(); }
-      auto node() const -> const Node<K, V>& { return this->_node; }
+      auto node() const -> const Node<K, V, M>& { return this->_node; }
 
     // helpers
     protected:
       // print a debug representation of the tree with the given indent
-      virtual auto show(std::ostream& os, uint indent) const -> std::ostream& override;
+      auto show(std::ostream& os, uint indent) const -> std::ostream&;
 
     private:
-      Node<K, V> _node;
+      Node<K, V, M> _node;
 
       // give the wrapper type access to this variant's internals
-      friend class FingerTree<K, V>;
+      friend class FingerTree<K, V, M>;
   };
 
-  template<typename K, typename V>
-  FingerTreeSingle<K, V>::FingerTreeSingle(
-    const Node<K, V>& node
+  template<typename K, typename V, typename M>
+  FingerTreeSingle<K, V, M>::FingerTreeSingle(
+    const Node<K, V, M>& node
   ) : _node(node) {}
 
-  template<typename K, typename V>
-  auto FingerTreeSingle<K, V>::show(std::ostream& os, uint indent) const -> std::ostream& {
+  template<typename K, typename V, typename M>
+  auto FingerTreeSingle<K, V, M>::show(std::ostream& os, uint indent) const -> std::ostream& {
     os << "Single" << std::endl;
     os << std::string((indent + 1) * 2, ' ');
     this->_node.show(os, indent + 1);
     return os;
   }
 
-  template<typename K, typename V>
-  std::ostream& operator<<(std::ostream& os, FingerTreeSingle<K, V> const& tree) {
+  template<typename K, typename V, typename M>
+  std::ostream& operator<<(std::ostream& os, FingerTreeSingle<K, V, M> const& tree) {
     return tree.show(os, 0);
   }
 }
@@ -0,0 +1,278 @@
+#pragma once
+
+// the middle tree of a deep finger tree, which may be suspended
+//
+// in the haskell implementation the middle tree is an unevaluated thunk,
+// overflowing pushes and underflowing pops on the middle tree are only done
+// once it is demanded, this is what gives the amortized O(1) bounds of push
+// and pop
+//
+// if FINGER_TREE_LAZY is defined, push and pop on a suspension record the
+// operation instead of applying it, otherwise they are applied eagerly and
+// suspensions are always forced
+//
+// a suspension forms a chain of pending operations which are shared between
+// copies and memoized, forcing walks down the chain and applies the
+// operations bottom up, this avoids recursing once for each pending
+// operation, as these chains can get very long if a middle tree is never
+// demanded
+//
+// a chain holds at most MAX_PENDING operations, once it's that long the
+// suspension is forced before deferring another one, this bounds the work
+// and the scratch space of a single force, which real time threads rely on
+// (see src/utils/slab_pool.hpp)
+//
+// the chain is held and locked through the thread policy of the tree, so
+// the thunks of thread local trees have plain reference counts and are
+// forced without locking
+
+#include "src/utils/scratch_arena.hpp"
+#include "src/utils/slab_pool.hpp"
+
+#include "src/collections/finger_tree/_prelude.hpp"
+#include "src/collections/finger_tree/core.hpp"
+#include "src/collections/finger_tree/measure.hpp"
+
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <sys/types.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace collections::finger_tree {
+  template<typename K, typename V, typename M>
+  class Suspension {
+    // constructors
+    public:
+      Suspension();
+
+      // create a forced suspension from the given tree
+      Suspension(FingerTree<K, V, M> const& tree);
+
+    // accessors
+    public:
+      // return the number of key value pairs in the suspended tree, this does
+      // not force the suspension
+      auto size() const -> uint;
+      auto is_empty() const -> bool { return this->size() == 0; }
+      auto is_forced() const -> bool { return this->_thunk == nullptr; }
+
+      // return the size of the block a pending operation is allocated in, see
+      // FingerTree::reserve
+      static auto thunk_size() -> std::size_t { return Policy::template shared_size<Thunk>(); }
+
+      // return the measure of the suspended tree, unlike the size this is not
+      // tracked while suspended, so this forces the suspension unless the
+      // measure is empty
+      auto measure() const -> typename M::Type;
+
+    // methods
+    public:
+      // force all pending operations and return the resulting tree
+      auto force() const -> FingerTree<K, V, M> const&;
+
+      // force all pending operations and return the resulting tree for
+      // modification, this detaches the suspension from the shared thunk but
+      // does not copy the tree itself
+      auto force_mut() -> FingerTree<K, V, M>&;
+
+      // push a node to the given side of the suspended tree
+      auto push(Direction dir, Node<K, V, M> const& node) -> void;
+
+      // pop a node from the given side of the suspended tree
+      //
+      // the node itself must be known immediately, so this forces the
+      // suspension, but not the removal of the node
+      auto pop(Direction dir) -> std::optional<Node<K, V, M>>;
+
+    private:
+      using Policy = typename measure::ThreadPolicyOf<M>::Type;
+
+      static constexpr uint MAX_PENDING = 64;
+
+      enum class Operation { Push, Pop };
+
+      // a pending operation on either a forced tree or another thunk
+      struct Thunk {
+        ~Thunk();
+
+        typename Policy::Mutex mutex;
+        std::optional<FingerTree<K, V, M>> value;
+
+        typename Policy::template SharedPtr<Thunk> base;
+        std::optional<FingerTree<K, V, M>> origin;
+
+        Operation op;
+        Direction dir;
+        std::optional<Node<K, V, M>> node;
+
+        // the number of operations in the chain up to and including this one,
+        // forced ones are counted too
+        uint pending;
+      };
+
+      // create a thunk applying the given operation on this suspension
+      auto suspend(
+        Operation op,
+        Direction dir,
+        std::optional<Node<K, V, M>> const& node
+      ) -> typename Policy::template SharedPtr<Thunk>;
+
+    private:
+      // the size is tracked eagerly while suspended, it's needed for the size
+      // of the deep tree and to check whether the middle tree is empty
+      uint _size;
+      FingerTree<K, V, M> _value;
+      typename Policy::template SharedPtr<Thunk> _thunk;
+  };
+
+  template<typename K, typename V, typename M>
+  Suspension<K, V, M>::Suspension() : _size(0), _value(), _thunk(nullptr) {}
+
+  template<typename K, typename V, typename M>
+  Suspension<K, V, M>::Suspension(
+    FingerTree<K, V, M> const& tree
+  ) : _size(0), _value(tree), _thunk(nullptr) {}
+
+  template<typename K, typename V, typename M>
+  Suspension<K, V, M>::Thunk::~Thunk() {
+    // unlink uniquely owned chains iteratively, otherwise dropping a long
+    // chain of unforced operations would recurse once per operation
+    auto next = std::move(this->base);
+    while (next != nullptr && next.use_count() == 1) {
+      auto tmp = std::move(next->base);
+      next = std::move(tmp);
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Suspension<K, V, M>::size() const -> uint {
+    return this->_thunk == nullptr ? this->_value.size() : this->_size;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Suspension<K, V, M>::measure() const -> typename M::Type {
+    if constexpr (std::is_empty_v<typename M::Type>) {
+      return M::identity();
+    } else {
+      return this->force().measure();
+    }
+  }
+
+  template<typename K, typename V, typename M>
+  auto Suspension<K, V, M>::force() const -> FingerTree<K, V, M> const& {
+    if (this->_thunk == nullptr) {
+      return this->_value;
+    }
+
+    // collect all unforced thunks, from the newest to the oldest
+    ScratchArena::Scope scope;
+    ScratchVector<typename Policy::template SharedPtr<Thunk>> chain;
+    auto current = this->_thunk;
+    while (current != nullptr) {
+      std::lock_guard<typename Policy::Mutex> lock(current->mutex);
+      if (current->value) {
+        break;
+      }
+
+      chain.emplace_back(current);
+      current = current->base;
+    }
+
+    // apply them from the oldest to the newest, the base of each thunk is
+    // forced by the time we reach it
+    for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+      auto& thunk = **it;
+      std::lock_guard<typename Policy::Mutex> lock(thunk.mutex);
+
+      // another thread may have forced this thunk in the meantime
+      if (thunk.value) {
+        continue;
+      }
+
+      // NOTE: the origin is not shared, moving it allows modifying it in place
+      FingerTree<K, V, M> tree = thunk.base != nullptr
+        ? *thunk.base->value
+        : std::move(*thunk.origin);
+
+      switch (thunk.op) {
+        case Operation::Push:
+          tree.push_node(thunk.dir, *thunk.node);
+          break;
+        case Operation::Pop:
+          tree.pop_node(thunk.dir);
+          break;
+      }
+
+      thunk.value = std::optional(tree);
+      thunk.base = nullptr;
+      thunk.origin = std::optional<FingerTree<K, V, M>>();
+      thunk.node = std::optional<Node<K, V, M>>();
+    }
+
+    return *this->_thunk->value;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Suspension<K, V, M>::force_mut() -> FingerTree<K, V, M>& {
+    if (this->_thunk != nullptr) {
+      this->_value = this->force();
+      this->_thunk = nullptr;
+    }
+
+    return this->_value;
+  }
+
+  template<typename K, typename V, typename M>
+  auto Suspension<K, V, M>::push(Direction dir, Node<K, V, M> const& node) -> void {
+#ifdef FINGER_TREE_LAZY
+    this->_size = this->size() + node.size();
+    this->_thunk = this->suspend(Operation::Push, dir, node);
+#else
+    this->_value.push_node(dir, node);
+#endif
+  }
+
+  template<typename K, typename V, typename M>
+  auto Suspension<K, V, M>::pop(Direction dir) -> std::optional<Node<K, V, M>> {
+#ifdef FINGER_TREE_LAZY
+    auto node = this->force().peek_node(dir);
+    if (node) {
+      this->_size = this->size() - node->size();
+      this->_thunk = this->suspend(Operation::Pop, dir, std::optional<Node<K, V, M>>());
+    }
+
+    return node;
+#else
+    return this->_value.pop_node(dir);
+#endif
+  }
+
+  template<typename K, typename V, typename M>
+  auto Suspension<K, V, M>::suspend(
+    Operation op,
+    Direction dir,
+    std::optional<Node<K, V, M>> const& node
+  ) -> typename Policy::template SharedPtr<Thunk> {
+    if (this->_thunk != nullptr && this->_thunk->pending >= MAX_PENDING) {
+      this->force_mut();
+    }
+
+    auto thunk = Policy::template make_shared<Thunk>();
+    thunk->op = op;
+    thunk->dir = dir;
+    thunk->node = node;
+    thunk->pending = this->_thunk != nullptr ? this->_thunk->pending + 1 : 1;
+
+    // NOTE: the value is only read again once the new thunk is forced
+    if (this->_thunk != nullptr) {
+      thunk->base = this->_thunk;
+    } else {
+      thunk->origin = std::optional(std::move(this->_value));
+    }
+
+    return thunk;
+  }
+}
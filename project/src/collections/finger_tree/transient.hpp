@@ -0,0 +1,134 @@
+#pragma once
+
+// a transient finger tree for batched modification
+//
+// a transient is created from a persistent tree and owns its tree exclusively,
+// it cannot be copied, so the nodes, digits and middle trees it modifies are
+// only copied the first time they are touched, if they are still shared with
+// the tree it was created from, every following modification is done in place
+//
+// once all modifications are done the transient is frozen into a persistent
+// tree again, this does not copy anything
+
+#include "src/utils/uninit_exception.hpp"
+
+#include "src/collections/finger_tree/_prelude.hpp"
+#include "src/collections/finger_tree/core.hpp"
+
+#include <optional>
+#include <sys/types.h>
+#include <utility>
+
+namespace collections::finger_tree {
+  template<typename K, typename V, typename M>
+  class Transient {
+    // constructors
+    public:
+      // create an empty transient
+      Transient();
+
+      // create a transient from the given tree, the tree itself is not
+      // modified
+      Transient(FingerTree<K, V, M> const& tree);
+
+      // transients own their tree exclusively
+      Transient(Transient<K, V, M> const& other) = delete;
+      Transient(Transient<K, V, M>&& other) = default;
+
+      auto operator=(Transient<K, V, M> const& other) -> Transient<K, V, M>& = delete;
+      auto operator=(Transient<K, V, M>&& other) -> Transient<K, V, M>& = default;
+
+    // accessors
+    public:
+      // return the number of key value pairs in this transient
+      auto size() const -> uint;
+      auto is_empty() const -> bool { return this->size() == 0; }
+
+    // methods
+    public:
+      // see FingerTree::get, the returned pointer is invalidated by any
+      // modification of this transient
+      auto get(K const& key) const -> V const*;
+
+      // see FingerTree::push
+      auto push(Direction dir, K const& key, V const& val) -> void;
+
+      // see FingerTree::pop
+      auto pop(Direction dir) -> std::optional<std::pair<K, V>>;
+
+      // see FingerTree::insert
+      auto insert(K const& key, V const& val) -> std::optional<V>;
+
+      // see FingerTree::remove
+      auto remove(K const& key) -> std::optional<V>;
+
+      // turn this transient back into a persistent tree, this transient is
+      // left uninitialized and must not be used afterwards
+      auto freeze() -> FingerTree<K, V, M>;
+
+    // helpers
+    public:
+      auto is_uninit() const -> bool { return this->_tree.is_uninit(); }
+
+      // ensure we're initalized (not frozen)
+      auto assert_init() const -> void;
+
+    private:
+      FingerTree<K, V, M> _tree;
+  };
+
+  template<typename K, typename V, typename M>
+  Transient<K, V, M>::Transient() : _tree() {}
+
+  template<typename K, typename V, typename M>
+  Transient<K, V, M>::Transient(FingerTree<K, V, M> const& tree) : _tree(tree) {}
+
+  template<typename K, typename V, typename M>
+  auto Transient<K, V, M>::size() const -> uint {
+    this->assert_init();
+    return this->_tree.size();
+  }
+
+  template<typename K, typename V, typename M>
+  auto Transient<K, V, M>::get(K const& key) const -> V const* {
+    this->assert_init();
+    return this->_tree.get(key);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Transient<K, V, M>::push(Direction dir, K const& key, V const& val) -> void {
+    this->assert_init();
+    this->_tree.push(dir, key, val);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Transient<K, V, M>::pop(Direction dir) -> std::optional<std::pair<K, V>> {
+    this->assert_init();
+    return this->_tree.pop(dir);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Transient<K, V, M>::insert(K const& key, V const& val) -> std::optional<V> {
+    this->assert_init();
+    return this->_tree.insert(key, val);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Transient<K, V, M>::remove(K const& key) -> std::optional<V> {
+    this->assert_init();
+    return this->_tree.remove(key);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Transient<K, V, M>::freeze() -> FingerTree<K, V, M> {
+    this->assert_init();
+    return std::move(this->_tree);
+  }
+
+  template<typename K, typename V, typename M>
+  auto Transient<K, V, M>::assert_init() const -> void {
+    if (this->is_uninit()) {
+      throw UninitException("Transient is uninitialized");
+    }
+  }
+}
@@ -1,10 +1,85 @@
 #include "src/collections/finger_tree/finger_tree.hpp"
 
+#include <cstdlib>
 #include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
 
 using FT = collections::finger_tree::FingerTree<int, int>;
+using FTS = collections::finger_tree::FingerTree<int, std::string>;
 using Dir = collections::finger_tree::Direction;
 
+// count the calls to the global allocator while counting is set, so real time
+// mode can be checked to never call it
+static thread_local bool counting = false;
+static thread_local uint allocations = 0;
+
+auto operator new(std::size_t size) -> void* {
+  if (counting) {
+    allocations++;
+  }
+
+  if (auto ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+
+  throw std::bad_alloc();
+}
+
+auto operator delete(void* ptr) noexcept -> void { std::free(ptr); }
+auto operator delete(void* ptr, std::size_t) noexcept -> void { std::free(ptr); }
+
+// insert a batch with a duplicate key into a tree of the given size and check
+// that no value was lost, values which are not trivially copyable catch
+// pairs being moved onto themselves
+auto check_insert_batch(int size) -> bool {
+  auto tree = FTS();
+  for (int i = 0; i < size; i++) {
+    tree.insert(2 * i, std::to_string(i));
+  }
+
+  std::vector<std::pair<int, std::string>> batch = {
+    {7, "seven, which is too long for the small string buffer"},
+    {5, "five, which is too long for the small string buffer too"},
+    {7, "seven again, the last value given for a key is kept"},
+  };
+  tree.insert_batch(batch);
+
+  return tree.size() == static_cast<uint>(size) + 2
+    && *tree.get(5) == batch[1].second
+    && *tree.get(7) == batch[2].second;
+}
+
+// run a mix of modifications on a tree in real time mode after reserving
+// blocks for them and return the number of calls to the global allocator
+auto count_realtime_allocations() -> uint {
+  auto tree = FT();
+  for (int i = 0; i < 20000; i++) {
+    tree.insert(2 * i, i);
+  }
+
+  FT::reserve(4096);
+
+  SlabPool::Realtime realtime;
+  allocations = 0;
+  counting = true;
+  for (int i = 0; i < 300; i++) {
+    tree.insert(2 * i + 1, i);
+    tree.push(Dir::Right, 100000 + i, i);
+    tree.remove(2 * i);
+    tree.pop(Dir::Left);
+
+    auto [left, val, right] = tree.split(10000 + 2 * i);
+    tree = FT::concat(left, right);
+    tree.erase_range(20000 + 10 * i, 20000 + 10 * i + 6);
+  }
+  counting = false;
+
+  return allocations;
+}
+
 auto main() -> int {
   auto tree = FT();
 
@@ -14,5 +89,17 @@ auto main() -> int {
 
   std::cout << tree << std::endl;
 
+  for (int size : {0, 100}) {
+    if (!check_insert_batch(size)) {
+      std::cerr << "insert_batch lost a value for a tree of size " << size << std::endl;
+      return 1;
+    }
+  }
+
+  if (auto count = count_realtime_allocations(); count != 0) {
+    std::cerr << "real time mode called the global allocator " << count << " times" << std::endl;
+    return 1;
+  }
+
   return 0;
 }
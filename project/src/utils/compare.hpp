@@ -0,0 +1,66 @@
+#pragma once
+
+// key comparators of the ordered collections
+//
+// a comparator is a stateless type which compares two keys in a single call
+// and returns the result as a three-way comparison, the result is only ever
+// compared against 0, so any of the standard comparison categories may be
+// returned
+//
+//   auto operator()(K const& a, K const& b) const -> std::weak_ordering;
+//
+// searches compare each key they pass once instead of asking for >= and ==
+// separately, which matters for keys like strings where every comparison
+// walks both keys
+//
+// if a comparator names is_transparent, like std::less<>, the lookup
+// functions of a collection accept any key type it can compare with, for
+// example a string view can be looked up in a tree of strings without
+// constructing a string first
+//
+//   using is_transparent = void;
+
+#include <compare>
+#include <concepts>
+
+// NOTE: nested in collections, so user code may use the name compare freely
+namespace collections::compare {
+  // the default comparator, using operator<=> if the key has one and
+  // operator< and operator== otherwise
+  template<typename K = void>
+  struct ThreeWay {
+    auto operator()(K const& a, K const& b) const {
+      if constexpr (std::three_way_comparable<K>) {
+        return a <=> b;
+      } else {
+        return std::compare_weak_order_fallback(a, b);
+      }
+    }
+  };
+
+  // the transparent default comparator, this compares any two types which
+  // can be compared with operator<=> or operator< and operator==
+  template<>
+  struct ThreeWay<void> {
+    using is_transparent = void;
+
+    template<typename A, typename B>
+    auto operator()(A const& a, B const& b) const {
+      if constexpr (std::three_way_comparable_with<A, B>) {
+        return a <=> b;
+      } else {
+        return a == b
+          ? std::weak_ordering::equivalent
+          : a < b ? std::weak_ordering::less : std::weak_ordering::greater;
+      }
+    }
+  };
+
+  template<typename C>
+  concept Transparent = requires { typename C::is_transparent; };
+
+  // whether keys of type Q may be looked up among keys of type K ordered by
+  // the comparator C
+  template<typename Q, typename K, typename C>
+  concept Lookup = std::same_as<Q, K> || Transparent<C>;
+}
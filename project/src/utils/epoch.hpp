@@ -0,0 +1,239 @@
+#pragma once
+
+// epoch based reclamation
+//
+// readers enter the domain with a Guard before reading shared pointers and
+// leave it once they no longer use them, entering and leaving only stores to
+// a record owned by the reading thread, so readers do no atomic read modify
+// write operations and don't write to shared cache lines
+//
+// writers retire objects they have unlinked instead of destroying them, a
+// retired object is destroyed once the global epoch has advanced twice, the
+// epoch only advances once every reader inside the domain has observed the
+// current one, so by then no reader can still refer to the object
+//
+// records are claimed by a thread on first use of a domain and kept until the
+// domain is destroyed, so a domain must outlive its readers, a thread drops
+// its references to records of destroyed domains the next time it claims one
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+class EpochDomain {
+  // constructors
+  public:
+    EpochDomain();
+
+    EpochDomain(EpochDomain const&) = delete;
+    auto operator=(EpochDomain const&) -> EpochDomain& = delete;
+
+    // destroys all retired objects, no reader may be inside the domain
+    ~EpochDomain();
+
+  private:
+    struct Record;
+
+  public:
+    // keeps the calling thread inside the domain for its lifetime, guards may
+    // be nested
+    class Guard {
+      public:
+        Guard(EpochDomain& domain);
+
+        Guard(Guard const&) = delete;
+        auto operator=(Guard const&) -> Guard& = delete;
+
+        ~Guard();
+
+      private:
+        EpochDomain& _domain;
+
+        // NOTE: the record of the calling thread, kept so leaving the domain
+        // doesn't look it up again
+        Record& _record;
+    };
+
+  // accessors
+  public:
+    // return the number of retired objects which were not yet destroyed
+    auto pending() const -> uint;
+
+  // methods
+  public:
+    // destroy the given object by calling func once no reader can refer to it
+    // anymore, this may destroy other retired objects on the calling thread
+    auto retire(std::function<void()> func) -> void;
+
+    // try to advance the epoch and destroy all retired objects which are no
+    // longer reachable, return the number of destroyed objects
+    auto collect() -> uint;
+
+  private:
+    struct alignas(64) Record {
+      // the epoch the owning thread observed when it entered the domain, or
+      // zero outside the domain
+      std::atomic<std::uint64_t> epoch = 0;
+
+      // the guard nesting depth, only accessed by the owning thread
+      uint depth = 0;
+    };
+
+    struct Retired {
+      std::uint64_t epoch;
+      std::function<void()> func;
+    };
+
+  private:
+    // the record of the calling thread, claimed on first use
+    auto record() -> Record&;
+
+    auto enter(Record& record) -> void;
+    auto leave(Record& record) -> void;
+
+    // advance the epoch if every reader inside the domain observed the
+    // current one and return the resulting epoch, _mutex must be held
+    auto advance() -> std::uint64_t;
+
+  private:
+    // NOTE: ids are never reused, unlike addresses, so a thread can tell
+    // a new domain apart from a destroyed one it entered before
+    inline static std::atomic<std::uint64_t> _next_id = 0;
+
+    std::uint64_t _id;
+
+    // zero is reserved for threads outside the domain
+    std::atomic<std::uint64_t> _epoch;
+
+    mutable std::mutex _mutex;
+
+    // NOTE: threads refer to the records weakly, so they can tell once the
+    // domain is destroyed and drop their references
+    std::shared_ptr<std::deque<Record>> _records;
+    std::vector<Retired> _retired;
+};
+
+inline EpochDomain::EpochDomain()
+  : _id(EpochDomain::_next_id.fetch_add(1)), _epoch(1), _records(std::make_shared<std::deque<Record>>()) {}
+
+inline EpochDomain::~EpochDomain() {
+  for (auto& retired : this->_retired) {
+    retired.func();
+  }
+}
+
+inline EpochDomain::Guard::Guard(EpochDomain& domain) : _domain(domain), _record(domain.record()) {
+  this->_domain.enter(this->_record);
+}
+
+inline EpochDomain::Guard::~Guard() {
+  this->_domain.leave(this->_record);
+}
+
+inline auto EpochDomain::pending() const -> uint {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  return this->_retired.size();
+}
+
+inline auto EpochDomain::retire(std::function<void()> func) -> void {
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_retired.emplace_back(Retired{this->_epoch.load(std::memory_order_acquire), std::move(func)});
+  }
+
+  this->collect();
+}
+
+inline auto EpochDomain::collect() -> uint {
+  std::vector<Retired> ready;
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    auto epoch = this->advance();
+
+    // NOTE: readers may still be inside the epoch after the one an object was
+    // retired in, as they may have entered before it was unlinked
+    auto it = std::partition(
+      this->_retired.begin(),
+      this->_retired.end(),
+      [epoch](Retired const& retired) { return retired.epoch + 2 > epoch; }
+    );
+
+    std::move(it, this->_retired.end(), std::back_inserter(ready));
+    this->_retired.erase(it, this->_retired.end());
+  }
+
+  // NOTE: destroying objects may retire others, so this is done unlocked
+  for (auto& retired : ready) {
+    retired.func();
+  }
+
+  return ready.size();
+}
+
+inline auto EpochDomain::record() -> Record& {
+  struct Entry {
+    std::uint64_t id;
+    std::weak_ptr<std::deque<Record>> records;
+    Record* record;
+  };
+
+  thread_local std::vector<Entry> entries;
+
+  for (auto& entry : entries) {
+    if (entry.id == this->_id) {
+      return *entry.record;
+    }
+  }
+
+  // drop the entries of destroyed domains, otherwise a thread entering many
+  // short lived domains would keep one entry for each of them
+  std::erase_if(entries, [](Entry const& entry) { return entry.records.expired(); });
+
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  auto& record = this->_records->emplace_back();
+  entries.emplace_back(Entry{this->_id, this->_records, &record});
+  return record;
+}
+
+inline auto EpochDomain::enter(Record& record) -> void {
+  if (record.depth++ != 0) {
+    return;
+  }
+
+  record.epoch.store(this->_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+  // NOTE: orders the store of our epoch before any following load of a shared
+  // pointer, otherwise a writer could advance past us without seeing it
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+inline auto EpochDomain::leave(Record& record) -> void {
+  if (--record.depth != 0) {
+    return;
+  }
+
+  record.epoch.store(0, std::memory_order_release);
+}
+
+inline auto EpochDomain::advance() -> std::uint64_t {
+  auto epoch = this->_epoch.load(std::memory_order_relaxed);
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  for (auto& record : *this->_records) {
+    auto observed = record.epoch.load(std::memory_order_acquire);
+    if (observed != 0 && observed != epoch) {
+      return epoch;
+    }
+  }
+
+  this->_epoch.store(epoch + 1, std::memory_order_release);
+  return epoch + 1;
+}
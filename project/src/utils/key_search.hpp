@@ -0,0 +1,205 @@
+#pragma once
+
+// vectorized search over small sorted arrays of keys
+//
+// the inner nodes of both collections have only a handful of children, so
+// the child a key belongs to is found by counting the child keys which are
+// less than it, for arithmetic keys ordered by the default comparator this
+// is done with SSE2 or AVX2 compares over the whole array at once, instead
+// of comparing the keys one after another, other keys use a scalar loop
+//
+// which instruction set is used is decided at compile time, AVX2 is only
+// used if the compiler targets it (for example with -mavx2, see config.pro),
+// 64 bit integers need at least SSE4.2, everything else falls back to scalar
+// compares
+//
+// InlineKeys stores the keys of the children of a node inside the node
+// itself, so finding a child doesn't dereference every candidate to read its
+// key, unused slots hold a padding key which is never less than any other
+// key, so searches always cover the full array and don't depend on the
+// number of children
+
+#include "src/utils/compare.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <sys/types.h>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace key_search {
+  // whether keys of type K ordered by the comparator C are searched
+  // vectorized and stored in InlineKeys
+  template<typename K, typename C>
+  constexpr bool IS_VECTORIZED = std::is_arithmetic_v<K>
+    && !std::is_same_v<K, bool>
+    && (std::is_same_v<C, collections::compare::ThreeWay<K>> || std::is_same_v<C, collections::compare::ThreeWay<>>);
+
+  // return a key which is not less than any other key
+  template<typename K>
+  constexpr auto padding() -> K {
+    if constexpr (std::numeric_limits<K>::has_infinity) {
+      return std::numeric_limits<K>::infinity();
+    } else {
+      return std::numeric_limits<K>::max();
+    }
+  }
+
+  // return the number of the given keys which are less than the given key,
+  // for sorted keys this is the index of the first one not less than it
+  template<typename K>
+  auto lower_bound(K const* keys, uint count, K key) -> uint {
+    uint rank = 0;
+    uint i = 0;
+
+#if defined(__AVX2__)
+    if constexpr (std::is_integral_v<K> && sizeof(K) == 4) {
+      // NOTE: flipping the sign bit turns an unsigned compare into a signed
+      // one
+      auto flip = _mm256_set1_epi32(std::is_signed_v<K> ? 0 : INT32_MIN);
+      auto needle = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int32_t>(key)), flip);
+      for (; i + 8 <= count; i += 8) {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(keys + i));
+        auto less = _mm256_cmpgt_epi32(needle, _mm256_xor_si256(chunk, flip));
+        rank += std::popcount(static_cast<uint>(_mm256_movemask_ps(_mm256_castsi256_ps(less))));
+      }
+    } else if constexpr (std::is_integral_v<K> && sizeof(K) == 8) {
+      auto flip = _mm256_set1_epi64x(std::is_signed_v<K> ? 0 : INT64_MIN);
+      auto needle = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<int64_t>(key)), flip);
+      for (; i + 4 <= count; i += 4) {
+        auto chunk = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(keys + i));
+        auto less = _mm256_cmpgt_epi64(needle, _mm256_xor_si256(chunk, flip));
+        rank += std::popcount(static_cast<uint>(_mm256_movemask_pd(_mm256_castsi256_pd(less))));
+      }
+    } else if constexpr (std::is_same_v<K, float>) {
+      auto needle = _mm256_set1_ps(key);
+      for (; i + 8 <= count; i += 8) {
+        auto less = _mm256_cmp_ps(_mm256_loadu_ps(keys + i), needle, _CMP_LT_OQ);
+        rank += std::popcount(static_cast<uint>(_mm256_movemask_ps(less)));
+      }
+    } else if constexpr (std::is_same_v<K, double>) {
+      auto needle = _mm256_set1_pd(key);
+      for (; i + 4 <= count; i += 4) {
+        auto less = _mm256_cmp_pd(_mm256_loadu_pd(keys + i), needle, _CMP_LT_OQ);
+        rank += std::popcount(static_cast<uint>(_mm256_movemask_pd(less)));
+      }
+    }
+#endif
+
+#if defined(__SSE2__)
+    if constexpr (std::is_integral_v<K> && sizeof(K) == 4) {
+      auto flip = _mm_set1_epi32(std::is_signed_v<K> ? 0 : INT32_MIN);
+      auto needle = _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(key)), flip);
+      for (; i + 4 <= count; i += 4) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(keys + i));
+        auto less = _mm_cmpgt_epi32(needle, _mm_xor_si128(chunk, flip));
+        rank += std::popcount(static_cast<uint>(_mm_movemask_ps(_mm_castsi128_ps(less))));
+      }
+    } else if constexpr (std::is_same_v<K, float>) {
+      auto needle = _mm_set1_ps(key);
+      for (; i + 4 <= count; i += 4) {
+        auto less = _mm_cmplt_ps(_mm_loadu_ps(keys + i), needle);
+        rank += std::popcount(static_cast<uint>(_mm_movemask_ps(less)));
+      }
+    } else if constexpr (std::is_same_v<K, double>) {
+      auto needle = _mm_set1_pd(key);
+      for (; i + 2 <= count; i += 2) {
+        auto less = _mm_cmplt_pd(_mm_loadu_pd(keys + i), needle);
+        rank += std::popcount(static_cast<uint>(_mm_movemask_pd(less)));
+      }
+    }
+#endif
+
+#if defined(__SSE4_2__)
+    if constexpr (std::is_integral_v<K> && sizeof(K) == 8) {
+      auto flip = _mm_set1_epi64x(std::is_signed_v<K> ? 0 : INT64_MIN);
+      auto needle = _mm_xor_si128(_mm_set1_epi64x(static_cast<int64_t>(key)), flip);
+      for (; i + 2 <= count; i += 2) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(keys + i));
+        auto less = _mm_cmpgt_epi64(needle, _mm_xor_si128(chunk, flip));
+        rank += std::popcount(static_cast<uint>(_mm_movemask_pd(_mm_castsi128_pd(less))));
+      }
+    }
+#endif
+
+    for (; i < count; i++) {
+      rank += keys[i] < key;
+    }
+
+    return rank;
+  }
+
+  // the keys of up to N children stored inside their parent, this is empty
+  // for keys which are not searched vectorized, see IS_VECTORIZED
+  //
+  // the children themselves are passed instead of their keys, so their keys
+  // are not read at all if this is empty
+  template<typename K, typename C, uint N, bool = IS_VECTORIZED<K, C>>
+  class InlineKeys {
+    public:
+      static constexpr bool IS_ENABLED = false;
+
+      template<typename T>
+      auto set(uint, T const&) -> void {}
+
+      template<typename T>
+      auto insert(uint, uint, T const&) -> void {}
+
+      auto erase(uint, uint) -> void {}
+  };
+
+  template<typename K, typename C, uint N>
+  class InlineKeys<K, C, N, true> {
+    public:
+      static constexpr bool IS_ENABLED = true;
+
+    // constructors
+    public:
+      InlineKeys() {
+        for (uint i = 0; i < N; i++) {
+          this->_keys[i] = padding<K>();
+        }
+      }
+
+    // accessors
+    public:
+      auto operator[](uint index) const -> K const& { return this->_keys[index]; }
+
+    // methods
+    public:
+      // return the index of the first key which is not less than the given
+      // key, or the number of used slots if there is none
+      auto lower_bound(K key) const -> uint { return key_search::lower_bound(this->_keys, N, key); }
+
+      // set the key at the given index to that of the given child
+      template<typename T>
+      auto set(uint index, T const& child) -> void { this->_keys[index] = child.key(); }
+
+      // insert the key of the given child at the given index of the given
+      // number of used slots
+      template<typename T>
+      auto insert(uint index, uint count, T const& child) -> void {
+        for (uint i = count; i > index; i--) {
+          this->_keys[i] = this->_keys[i - 1];
+        }
+
+        this->_keys[index] = child.key();
+      }
+
+      // erase the key at the given index of the given number of used slots
+      auto erase(uint index, uint count) -> void {
+        for (uint i = index; i + 1 < count; i++) {
+          this->_keys[i] = this->_keys[i + 1];
+        }
+
+        this->_keys[count - 1] = padding<K>();
+      }
+
+    private:
+      K _keys[N];
+  };
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+// a shared pointer with a non-atomic reference count
+//
+// like std::shared_ptr created by std::allocate_shared, the object is
+// allocated together with its reference count from the slab pool and the
+// count knows how to destroy the concrete type, so a pointer to a derived
+// object converts to a pointer to its base without a virtual destructor
+//
+// the count is a LocalRefCount, so it must never leave the thread it was
+// created on, see thread_policy::Local
+
+#include "src/utils/ref_count.hpp"
+#include "src/utils/slab_pool.hpp"
+
+#include <concepts>
+#include <cstddef>
+#include <new>
+#include <sys/types.h>
+#include <type_traits>
+#include <utility>
+
+// the reference count of an object managed by a LocalSharedPtr
+struct LocalControl {
+  LocalRefCount count;
+  void (*destroy)(LocalControl*);
+};
+
+template<typename T>
+class LocalSharedPtr {
+  // constructors
+  public:
+    LocalSharedPtr() : _ptr(nullptr), _control(nullptr) {}
+    LocalSharedPtr(std::nullptr_t) : LocalSharedPtr() {}
+
+    LocalSharedPtr(LocalSharedPtr const& other);
+    LocalSharedPtr(LocalSharedPtr&& other) noexcept;
+
+    template<typename U> requires std::convertible_to<U*, T*>
+    LocalSharedPtr(LocalSharedPtr<U> const& other);
+
+    template<typename U> requires std::convertible_to<U*, T*>
+    LocalSharedPtr(LocalSharedPtr<U>&& other) noexcept;
+
+    auto operator=(LocalSharedPtr const& other) -> LocalSharedPtr&;
+    auto operator=(LocalSharedPtr&& other) noexcept -> LocalSharedPtr&;
+
+    ~LocalSharedPtr();
+
+    // allocate an object constructed from the given arguments
+    template<typename... Args>
+    static auto make(Args&&... args) -> LocalSharedPtr;
+
+    // return the size of the block make allocates, the object and its count
+    static constexpr auto block_size() -> std::size_t { return sizeof(Block); }
+
+  private:
+    LocalSharedPtr(T* ptr, LocalControl* control) : _ptr(ptr), _control(control) {}
+
+  // accessors
+  public:
+    auto get() const -> T* { return this->_ptr; }
+    auto operator*() const -> T& { return *this->_ptr; }
+    auto operator->() const -> T* { return this->_ptr; }
+
+    explicit operator bool() const { return this->_ptr != nullptr; }
+    auto operator==(std::nullptr_t) const -> bool { return this->_ptr == nullptr; }
+
+    // return the number of pointers sharing the object, or zero if this is
+    // null
+    auto use_count() const -> uint {
+      return this->_control == nullptr ? 0 : this->_control->count.count();
+    }
+
+  private:
+    // the object and its reference count in a single allocation
+    struct Block : LocalControl {
+      template<typename... Args>
+      Block(Args&&... args) : LocalControl{LocalRefCount(), &Block::destroy}, value(std::forward<Args>(args)...) {}
+
+      static auto destroy(LocalControl* control) -> void;
+
+      T value;
+    };
+
+    // drop our reference and destroy the object if it was the last one
+    auto release() -> void;
+
+  private:
+    template<typename U>
+    friend class LocalSharedPtr;
+
+    T* _ptr;
+    LocalControl* _control;
+};
+
+// NOTE: vectors of nodes only move their elements when they grow if moving
+// can't throw, otherwise every child is copied and released again
+static_assert(std::is_nothrow_move_constructible_v<LocalSharedPtr<int>>);
+
+template<typename T>
+LocalSharedPtr<T>::LocalSharedPtr(
+  LocalSharedPtr const& other
+) : _ptr(other._ptr), _control(other._control) {
+  if (this->_control != nullptr) {
+    this->_control->count.acquire();
+  }
+}
+
+template<typename T>
+LocalSharedPtr<T>::LocalSharedPtr(
+  LocalSharedPtr&& other
+) noexcept : _ptr(std::exchange(other._ptr, nullptr)), _control(std::exchange(other._control, nullptr)) {}
+
+template<typename T>
+template<typename U> requires std::convertible_to<U*, T*>
+LocalSharedPtr<T>::LocalSharedPtr(
+  LocalSharedPtr<U> const& other
+) : _ptr(other._ptr), _control(other._control) {
+  if (this->_control != nullptr) {
+    this->_control->count.acquire();
+  }
+}
+
+template<typename T>
+template<typename U> requires std::convertible_to<U*, T*>
+LocalSharedPtr<T>::LocalSharedPtr(
+  LocalSharedPtr<U>&& other
+) noexcept : _ptr(std::exchange(other._ptr, nullptr)), _control(std::exchange(other._control, nullptr)) {}
+
+template<typename T>
+auto LocalSharedPtr<T>::operator=(LocalSharedPtr const& other) -> LocalSharedPtr& {
+  // NOTE: acquire before releasing, the other pointer may be owned by the
+  // object we release
+  if (other._control != nullptr) {
+    other._control->count.acquire();
+  }
+
+  this->release();
+  this->_ptr = other._ptr;
+  this->_control = other._control;
+  return *this;
+}
+
+template<typename T>
+auto LocalSharedPtr<T>::operator=(LocalSharedPtr&& other) noexcept -> LocalSharedPtr& {
+  if (this != &other) {
+    auto ptr = std::exchange(other._ptr, nullptr);
+    auto control = std::exchange(other._control, nullptr);
+
+    this->release();
+    this->_ptr = ptr;
+    this->_control = control;
+  }
+
+  return *this;
+}
+
+template<typename T>
+LocalSharedPtr<T>::~LocalSharedPtr() {
+  this->release();
+}
+
+template<typename T>
+template<typename... Args>
+auto LocalSharedPtr<T>::make(Args&&... args) -> LocalSharedPtr {
+  auto memory = SlabAllocator<Block>().allocate(1);
+
+  Block* block;
+  try {
+    block = new (memory) Block(std::forward<Args>(args)...);
+  } catch (...) {
+    SlabAllocator<Block>().deallocate(memory, 1);
+    throw;
+  }
+
+  return LocalSharedPtr(&block->value, block);
+}
+
+template<typename T>
+auto LocalSharedPtr<T>::Block::destroy(LocalControl* control) -> void {
+  auto block = static_cast<Block*>(control);
+  block->~Block();
+  SlabAllocator<Block>().deallocate(block, 1);
+}
+
+template<typename T>
+auto LocalSharedPtr<T>::release() -> void {
+  auto control = std::exchange(this->_control, nullptr);
+  this->_ptr = nullptr;
+
+  if (control != nullptr && control->count.release()) {
+    control->destroy(control);
+  }
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+// deferred reclamation of dropped objects
+//
+// dropping the last reference to a large persistent tree destroys all of its
+// nodes which are not shared with another tree, on the thread that dropped it
+// and all at once, a reclaimer allows moving this work elsewhere
+//
+// while a Scope of a reclaimer is active on a thread, the collections hand
+// the nodes they would destroy to the reclaimer instead, destroying a
+// deferred node only defers its children in turn, so the garbage is destroyed
+// one node at a time, either by a background thread or by the owner calling
+// drain with a budget, for example once per iteration of a real time loop
+//
+// nodes of thread local collections (see src/utils/thread_policy.hpp) are
+// never handed to a background reclaimer, they're destroyed in place instead
+//
+// without a reclaimer nodes are destroyed recursively up to a fixed depth,
+// deeper nodes are put on a worklist of the calling thread and destroyed by
+// the outermost dispose, so destroying a tree needs a bounded amount of stack
+// regardless of its size, in real time mode (see src/utils/slab_pool.hpp) the
+// worklist never grows past the capacity given to reserve, further nodes are
+// destroyed recursively instead
+
+#include "src/utils/slab_pool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class Reclaimer {
+  // constructors
+  public:
+    // create a reclaimer which is only drained by calling drain
+    Reclaimer();
+
+    // create a reclaimer which is drained by a background thread if the given
+    // flag is set
+    Reclaimer(bool background);
+
+    Reclaimer(Reclaimer const&) = delete;
+    auto operator=(Reclaimer const&) -> Reclaimer& = delete;
+
+    // destroys all pending garbage, no scope of this reclaimer may be active
+    ~Reclaimer();
+
+  public:
+    // makes the given reclaimer the current one of the calling thread for its
+    // lifetime, scopes may be nested, the innermost one is current
+    class Scope {
+      public:
+        Scope(Reclaimer& reclaimer);
+
+        Scope(Scope const&) = delete;
+        auto operator=(Scope const&) -> Scope& = delete;
+
+        ~Scope();
+
+      private:
+        Reclaimer* _previous;
+    };
+
+  // accessors
+  public:
+    // return the current reclaimer of the calling thread, if any
+    static auto current() -> Reclaimer* { return Reclaimer::_current; }
+
+    auto is_background() const -> bool { return this->_background; }
+
+    // return the number of deferred objects which were not yet destroyed
+    auto pending() const -> uint;
+
+    // return the total number of deferred and destroyed objects
+    auto deferred() const -> std::uint64_t { return this->_deferred.load(std::memory_order_relaxed); }
+    auto reclaimed() const -> std::uint64_t { return this->_reclaimed.load(std::memory_order_relaxed); }
+
+  // methods
+  public:
+    // defer destroying the given object, destroy is called with it later
+    auto defer(void* object, void (*destroy)(void*)) -> void;
+
+    // destroy up to the given number of deferred objects on the calling
+    // thread and return how many were destroyed, objects deferred while
+    // draining count towards the budget once they're destroyed
+    auto drain(uint budget) -> uint;
+
+    // destroy all deferred objects on the calling thread
+    auto drain_all() -> void;
+
+    // hand the given object to the current reclaimer of the calling thread,
+    // or delete it on the calling thread if there is none, objects of thread
+    // local collections are never handed to a background reclaimer
+    template<typename T>
+    static auto dispose(T* object, bool is_local) -> void;
+
+    // ensure the worklist of the calling thread holds the given number of
+    // objects without growing, this must not be called in real time mode
+    static auto reserve(uint count) -> void { Reclaimer::_worklist.reserve(count); }
+
+  private:
+    struct Garbage {
+      void* object;
+      void (*destroy)(void*);
+    };
+
+  private:
+    template<typename T>
+    static auto destroy(void* object) -> void { delete static_cast<T*>(object); }
+
+    // take the most recently deferred object, if any
+    auto take(Garbage& garbage) -> bool;
+
+    auto work() -> void;
+
+  private:
+    inline static thread_local Reclaimer* _current = nullptr;
+
+    // the nesting depth of dispose on this thread without a reclaimer and the
+    // objects left to destroy by the outermost one, the worklist storage is
+    // kept between calls
+    static constexpr uint MAX_DISPOSE_DEPTH = 8;
+    inline static thread_local uint _depth = 0;
+    inline static thread_local std::vector<Garbage> _worklist;
+
+    // NOTE: the worklist needs dynamic initialization, checking this first
+    // keeps it off the common path
+    inline static thread_local bool _has_work = false;
+
+    // NOTE: unlike _worker this is set before the worker starts
+    bool _background;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stop;
+    std::vector<Garbage> _garbage;
+
+    std::atomic<std::uint64_t> _deferred;
+    std::atomic<std::uint64_t> _reclaimed;
+
+    std::thread _worker;
+};
+
+inline Reclaimer::Reclaimer() : Reclaimer(false) {}
+
+inline Reclaimer::Reclaimer(bool background) : _background(background), _stop(false), _deferred(0), _reclaimed(0) {
+  if (background) {
+    this->_worker = std::thread([this]() { this->work(); });
+  }
+}
+
+inline Reclaimer::~Reclaimer() {
+  if (this->_background) {
+    {
+      std::lock_guard<std::mutex> lock(this->_mutex);
+      this->_stop = true;
+    }
+
+    this->_wake.notify_one();
+    this->_worker.join();
+  }
+
+  Scope scope(*this);
+  this->drain_all();
+}
+
+inline Reclaimer::Scope::Scope(Reclaimer& reclaimer) : _previous(Reclaimer::_current) {
+  Reclaimer::_current = &reclaimer;
+}
+
+inline Reclaimer::Scope::~Scope() {
+  Reclaimer::_current = this->_previous;
+}
+
+inline auto Reclaimer::pending() const -> uint {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  return this->_garbage.size();
+}
+
+inline auto Reclaimer::defer(void* object, void (*destroy)(void*)) -> void {
+  bool was_empty;
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    was_empty = this->_garbage.empty();
+    this->_garbage.push_back(Garbage{object, destroy});
+  }
+
+  this->_deferred.fetch_add(1, std::memory_order_relaxed);
+
+  // NOTE: the worker only sleeps once there's no garbage left
+  if (was_empty && this->_background) {
+    this->_wake.notify_one();
+  }
+}
+
+inline auto Reclaimer::drain(uint budget) -> uint {
+  // NOTE: destroyed objects defer their children to us instead of recursing
+  Scope scope(*this);
+
+  uint count = 0;
+  Garbage garbage;
+  while (count < budget && this->take(garbage)) {
+    garbage.destroy(garbage.object);
+    count++;
+  }
+
+  this->_reclaimed.fetch_add(count, std::memory_order_relaxed);
+  return count;
+}
+
+inline auto Reclaimer::drain_all() -> void {
+  while (this->drain(UINT32_MAX) != 0) {}
+}
+
+template<typename T>
+auto Reclaimer::dispose(T* object, bool is_local) -> void {
+  auto reclaimer = Reclaimer::current();
+  if (reclaimer != nullptr && !(is_local && reclaimer->is_background())) {
+    reclaimer->defer(object, &Reclaimer::destroy<T>);
+    return;
+  }
+
+  // NOTE: recursing a few levels is cheaper than going through the worklist,
+  // the outermost dispose picks up what's left
+  // NOTE: growing the worklist would call the global allocator
+  bool is_full = SlabPool::is_realtime()
+    && Reclaimer::_worklist.size() == Reclaimer::_worklist.capacity();
+
+  if (Reclaimer::_depth >= Reclaimer::MAX_DISPOSE_DEPTH && !is_full) {
+    Reclaimer::_worklist.push_back(Garbage{object, &Reclaimer::destroy<T>});
+    Reclaimer::_has_work = true;
+    return;
+  }
+
+  Reclaimer::_depth++;
+  delete object;
+  if (Reclaimer::_depth == 1 && Reclaimer::_has_work) {
+    Reclaimer::_has_work = false;
+    while (!Reclaimer::_worklist.empty()) {
+      auto garbage = Reclaimer::_worklist.back();
+      Reclaimer::_worklist.pop_back();
+      garbage.destroy(garbage.object);
+    }
+  }
+  Reclaimer::_depth--;
+}
+
+inline auto Reclaimer::take(Garbage& garbage) -> bool {
+  std::lock_guard<std::mutex> lock(this->_mutex);
+  if (this->_garbage.empty()) {
+    return false;
+  }
+
+  // NOTE: the most recently deferred objects are the children of the most
+  // recently destroyed one, which are likely still cached
+  garbage = this->_garbage.back();
+  this->_garbage.pop_back();
+  return true;
+}
+
+inline auto Reclaimer::work() -> void {
+  while (true) {
+    this->drain_all();
+
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    this->_wake.wait(lock, [this]() { return this->_stop || !this->_garbage.empty(); });
+    if (this->_stop) {
+      return;
+    }
+  }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+// an intrusive reference count
+//
+// objects embedding this are managed by a handle which knows their concrete
+// type, so they need neither a control block nor a virtual destructor, the
+// handle increments the count when it's copied and destroys the object once
+// release reports that the last reference is gone
+
+#include <atomic>
+#include <cassert>
+#include <sys/types.h>
+#include <thread>
+
+class RefCount {
+  public:
+    RefCount() : _count(1) {}
+
+    // copying an object does not copy its references, the copy is only
+    // referred to by whoever created it
+    RefCount(RefCount const&) : _count(1) {}
+    auto operator=(RefCount const&) -> RefCount& { return *this; }
+
+  public:
+    // whether the owner is the only referent, the acquire pairs with the
+    // release of the other referents, so their reads happen before any
+    // subsequent writes of the owner
+    auto is_unique() const -> bool {
+      return this->_count.load(std::memory_order_acquire) == 1;
+    }
+
+    auto acquire() -> void {
+      this->_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // release a reference and return whether it was the last one, in which
+    // case the object must be destroyed by the caller
+    auto release() -> bool {
+      if (this->_count.fetch_sub(1, std::memory_order_release) == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+      }
+
+      return false;
+    }
+
+  private:
+    std::atomic<uint> _count;
+};
+
+// a reference count for objects which never leave the thread that created
+// them, see thread_policy::Local
+//
+// this is a plain integer, debug builds additionally check that it's only
+// used by the creating thread
+class LocalRefCount {
+  public:
+    LocalRefCount() : _count(1) {}
+
+    LocalRefCount(LocalRefCount const&) : _count(1) {}
+    auto operator=(LocalRefCount const&) -> LocalRefCount& { return *this; }
+
+  public:
+    auto is_unique() const -> bool {
+      this->assert_owner();
+      return this->_count == 1;
+    }
+
+    auto acquire() -> void {
+      this->assert_owner();
+      this->_count++;
+    }
+
+    auto release() -> bool {
+      this->assert_owner();
+      return --this->_count == 0;
+    }
+
+    // the number of references, unlike the atomic count this is exact
+    auto count() const -> uint {
+      this->assert_owner();
+      return this->_count;
+    }
+
+  private:
+    auto assert_owner() const -> void {
+      assert(
+        this->_owner == std::this_thread::get_id()
+        && "thread local tree used by another thread"
+      );
+    }
+
+  private:
+    uint _count;
+
+#ifndef NDEBUG
+    std::thread::id _owner = std::this_thread::get_id();
+#endif
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+// a thread local bump arena for temporaries of a single operation
+//
+// operations like concat or from_nodes build short lived vectors of nodes at
+// every level they recurse into, these are allocated by bumping a pointer
+// into a chunk of the calling thread's arena instead of going through the
+// global allocator, opening a Scope marks the current position of the arena
+// and closing it releases everything allocated since, so scopes nest with
+// the recursion of the operation
+//
+// only the storage of the temporaries lives in the arena, nodes which are
+// kept in the result are allocated and reference counted as usual, so nothing
+// needs to be copied out of the arena before the scope is closed
+//
+// the first chunk is kept once the outermost scope is closed, so operations
+// whose temporaries fit into it don't allocate at all after the first one, in
+// real time mode (see src/utils/slab_pool.hpp) the arena throws
+// std::bad_alloc instead of allocating new chunks
+
+#include "src/utils/slab_pool.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/types.h>
+#include <vector>
+
+class ScratchArena {
+  public:
+    // the size of regular chunks, larger allocations get a chunk of their own
+    static constexpr std::size_t CHUNK_SIZE = 16 * 1024;
+
+  private:
+    struct Chunk;
+
+  public:
+    // releases everything allocated on the calling thread's arena during its
+    // lifetime, scopes must be closed in the reverse order they were opened
+    class Scope {
+      public:
+        Scope();
+
+        Scope(Scope const&) = delete;
+        auto operator=(Scope const&) -> Scope& = delete;
+
+        ~Scope();
+
+      private:
+        Chunk* _chunk;
+        std::byte* _top;
+    };
+
+  // accessors
+  public:
+    // return the nesting depth of scopes on the calling thread
+    static auto depth() -> uint { return ScratchArena::state().depth; }
+
+  // methods
+  public:
+    // allocate from the calling thread's arena, this must be called inside a
+    // scope, the storage is valid until the innermost scope is closed
+    static auto allocate(std::size_t size, std::size_t align) -> void*;
+
+    // release the given storage early if it was the last allocation, this
+    // lets vectors grow in place
+    static auto deallocate(void* ptr, std::size_t size) -> void;
+
+    // ensure the calling thread has a regular chunk to allocate from, this
+    // must not be called in real time mode
+    static auto reserve() -> void;
+
+  private:
+    struct alignas(std::max_align_t) Chunk {
+      Chunk* prev;
+      std::size_t size;
+
+      auto begin() -> std::byte* { return reinterpret_cast<std::byte*>(this + 1); }
+      auto end() -> std::byte* { return this->begin() + this->size; }
+    };
+
+    struct State {
+      Chunk* chunk = nullptr;
+      std::byte* top = nullptr;
+      uint depth = 0;
+
+      // a regular chunk which is no longer used, kept for the next operation
+      Chunk* spare = nullptr;
+
+      ~State();
+    };
+
+  private:
+    static auto state() -> State&;
+
+    // push a new chunk with room for at least the given number of bytes
+    static auto grow(std::size_t size) -> void;
+
+    // pop the current chunk
+    static auto shrink() -> void;
+};
+
+inline ScratchArena::Scope::Scope() {
+  auto& state = ScratchArena::state();
+  this->_chunk = state.chunk;
+  this->_top = state.top;
+  state.depth++;
+}
+
+inline ScratchArena::Scope::~Scope() {
+  auto& state = ScratchArena::state();
+  while (state.chunk != this->_chunk) {
+    ScratchArena::shrink();
+  }
+
+  state.top = this->_top;
+  state.depth--;
+}
+
+inline auto ScratchArena::allocate(std::size_t size, std::size_t align) -> void* {
+  auto& state = ScratchArena::state();
+  assert(state.depth != 0 && "scratch allocation outside of a scope");
+
+  if (state.chunk != nullptr) {
+    auto addr = reinterpret_cast<std::uintptr_t>(state.top);
+    auto ptr = reinterpret_cast<std::byte*>((addr + align - 1) & ~(align - 1));
+    if (ptr + size <= state.chunk->end()) {
+      state.top = ptr + size;
+      return ptr;
+    }
+  }
+
+  // NOTE: chunk storage is aligned to max_align_t, larger alignments need
+  // room to be padded
+  ScratchArena::grow(size + align);
+  return ScratchArena::allocate(size, align);
+}
+
+inline auto ScratchArena::deallocate(void* ptr, std::size_t size) -> void {
+  auto& state = ScratchArena::state();
+  if (static_cast<std::byte*>(ptr) + size == state.top) {
+    state.top = static_cast<std::byte*>(ptr);
+  }
+}
+
+inline auto ScratchArena::reserve() -> void {
+  auto& state = ScratchArena::state();
+  if (state.chunk == nullptr && state.spare == nullptr) {
+    ScratchArena::grow(CHUNK_SIZE);
+    ScratchArena::shrink();
+  }
+}
+
+inline ScratchArena::State::~State() {
+  while (this->chunk != nullptr) {
+    auto prev = this->chunk->prev;
+    ::operator delete(this->chunk);
+    this->chunk = prev;
+  }
+
+  ::operator delete(this->spare);
+}
+
+inline auto ScratchArena::state() -> State& {
+  thread_local State state;
+  return state;
+}
+
+inline auto ScratchArena::grow(std::size_t size) -> void {
+  auto& state = ScratchArena::state();
+
+  Chunk* chunk;
+  if (size <= CHUNK_SIZE && state.spare != nullptr) {
+    chunk = state.spare;
+    state.spare = nullptr;
+  } else if (SlabPool::is_realtime()) {
+    throw std::bad_alloc();
+  } else {
+    auto chunk_size = size <= CHUNK_SIZE ? CHUNK_SIZE : size;
+    chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + chunk_size));
+    chunk->size = chunk_size;
+  }
+
+  chunk->prev = state.chunk;
+  state.chunk = chunk;
+  state.top = chunk->begin();
+}
+
+inline auto ScratchArena::shrink() -> void {
+  auto& state = ScratchArena::state();
+  auto chunk = state.chunk;
+  state.chunk = chunk->prev;
+
+  if (chunk->size == CHUNK_SIZE && state.spare == nullptr) {
+    state.spare = chunk;
+  } else {
+    ::operator delete(chunk);
+  }
+}
+
+// an allocator using the scratch arena of the calling thread, containers
+// using it must be destroyed before the scope they were filled in is closed
+template<typename T>
+struct ScratchAllocator {
+  using value_type = T;
+
+  ScratchAllocator() = default;
+
+  template<typename U>
+  ScratchAllocator(ScratchAllocator<U> const&) {}
+
+  auto allocate(std::size_t n) -> T* {
+    return static_cast<T*>(ScratchArena::allocate(n * sizeof(T), alignof(T)));
+  }
+
+  auto deallocate(T* ptr, std::size_t n) -> void {
+    ScratchArena::deallocate(ptr, n * sizeof(T));
+  }
+
+  template<typename U>
+  auto operator==(ScratchAllocator<U> const&) const -> bool { return true; }
+};
+
+template<typename T>
+using ScratchVector = std::vector<T, ScratchAllocator<T>>;
@@ -0,0 +1,368 @@
+#pragma once
+
+// a size class slab pool for the nodes of the persistent collections
+//
+// blocks are handed out in size classes of 16 bytes up to MAX_SIZE, each
+// thread caches free blocks per size class in two magazines, lists of up to
+// MAGAZINE_SIZE blocks, so allocating and freeing a block is a pop or push on
+// a thread local list, once both magazines are full a full one is handed to a
+// shared depot and once both are empty a full one is taken from it, before a
+// new slab is carved from the global allocator, this moves whole magazines
+// under the depot's lock instead of single blocks and keeps threads which
+// alternate between allocating and freeing from going to the depot at all
+//
+// the depot only holds magazines of MAGAZINE_SIZE blocks, except for one
+// partial magazine per size class, larger magazines, like a fresh slab or
+// those grown in real time mode, are split and smaller ones, like those left
+// by an exiting thread, are merged into the partial one
+//
+// blocks freed on another thread than they were allocated on simply move to
+// that thread's cache, slabs are never returned to the global allocator,
+// their blocks are kept for reuse
+//
+// a thread may reserve blocks up front and then enter real time mode with a
+// Realtime guard, while inside it, allocations are only served from the
+// thread's magazines and neither lock the depot nor call the global
+// allocator, if they run dry std::bad_alloc is thrown instead
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+class SlabPool {
+  public:
+    // the granularity and the largest size of the size classes, larger
+    // allocations go to the global allocator
+    static constexpr std::size_t CLASS_SIZE = 16;
+    static constexpr std::size_t MAX_SIZE = 512;
+
+    // the size of the slabs blocks are carved from
+    static constexpr std::size_t SLAB_SIZE = 64 * 1024;
+
+    // the number of blocks in a full magazine, in real time mode magazines
+    // grow beyond this instead of being handed to the depot
+    static constexpr uint MAGAZINE_SIZE = 256;
+
+  public:
+    // keeps the calling thread in real time mode for its lifetime, guards may
+    // be nested
+    class Realtime {
+      public:
+        Realtime();
+
+        Realtime(Realtime const&) = delete;
+        auto operator=(Realtime const&) -> Realtime& = delete;
+
+        ~Realtime();
+    };
+
+  // accessors
+  public:
+    // return the number of blocks for allocations of the given size in the
+    // magazines of the calling thread
+    static auto cached(std::size_t size) -> uint;
+
+    static auto is_realtime() -> bool { return SlabPool::_realtime != 0; }
+
+    // return the size of the blocks allocations of the given size are served
+    // from, or zero if they are not served from the pool
+    static auto block_size(std::size_t size) -> std::size_t;
+
+  // methods
+  public:
+    static auto allocate(std::size_t size) -> void*;
+    static auto deallocate(void* ptr, std::size_t size) -> void;
+
+    // ensure the magazines of the calling thread hold at least the given
+    // number of blocks for allocations of the given size, this must not be
+    // called in real time mode
+    static auto reserve(std::size_t size, uint count) -> void;
+
+  private:
+    static constexpr std::size_t CLASS_COUNT = MAX_SIZE / CLASS_SIZE;
+
+    // free blocks are linked through their first bytes
+    struct Block {
+      Block* next;
+    };
+
+    struct Magazine {
+      Block* head = nullptr;
+      uint size = 0;
+
+      auto push(Block* block) -> void;
+      auto pop() -> Block*;
+
+      // detach the given number of blocks into a magazine of their own, the
+      // magazine must hold at least that many
+      auto split(uint count) -> Magazine;
+    };
+
+    struct Cache {
+      // blocks are taken from and returned to the loaded magazine, the
+      // previous one is swapped in once it runs empty or full
+      Magazine loaded[CLASS_COUNT];
+      Magazine previous[CLASS_COUNT];
+
+      // return all magazines to the depot once the thread exits
+      ~Cache();
+    };
+
+    struct Depot {
+      std::mutex mutex;
+      std::vector<Magazine> full[CLASS_COUNT];
+
+      // less than MAGAZINE_SIZE blocks which are handed out once there are
+      // no full magazines left
+      Magazine partial[CLASS_COUNT];
+
+      // add the given magazine of any size, splitting it into full magazines
+      // and merging the rest into the partial one, the mutex must be held
+      auto stock(std::size_t index, Magazine magazine) -> void;
+    };
+
+  private:
+    static auto index(std::size_t size) -> std::size_t { return (size - 1) / CLASS_SIZE; }
+
+    static auto cache() -> Cache&;
+
+    // NOTE: this is never destroyed, thread caches may be destroyed after
+    // static objects at exit and still return their magazines to it
+    static auto depot() -> Depot&;
+
+    // return a magazine from the depot, or one carved from a new slab if the
+    // depot has none, the rest of the slab is stocked in the depot
+    static auto take(std::size_t index) -> Magazine;
+
+    // hand the given magazine to the depot
+    static auto give(std::size_t index, Magazine magazine) -> void;
+
+  private:
+    inline static thread_local uint _realtime = 0;
+};
+
+inline SlabPool::Realtime::Realtime() {
+  SlabPool::_realtime++;
+}
+
+inline SlabPool::Realtime::~Realtime() {
+  SlabPool::_realtime--;
+}
+
+inline auto SlabPool::cached(std::size_t size) -> uint {
+  if (size == 0 || size > MAX_SIZE) {
+    return 0;
+  }
+
+  auto& cache = SlabPool::cache();
+  auto idx = SlabPool::index(size);
+  return cache.loaded[idx].size + cache.previous[idx].size;
+}
+
+inline auto SlabPool::block_size(std::size_t size) -> std::size_t {
+  return size > MAX_SIZE ? 0 : (SlabPool::index(size == 0 ? 1 : size) + 1) * CLASS_SIZE;
+}
+
+inline auto SlabPool::allocate(std::size_t size) -> void* {
+  if (size > MAX_SIZE) {
+    if (SlabPool::is_realtime()) {
+      throw std::bad_alloc();
+    }
+
+    return ::operator new(size);
+  }
+
+  auto idx = SlabPool::index(size == 0 ? 1 : size);
+  auto& cache = SlabPool::cache();
+  auto& loaded = cache.loaded[idx];
+  if (loaded.head != nullptr) {
+    return loaded.pop();
+  }
+
+  auto& previous = cache.previous[idx];
+  if (previous.head != nullptr) {
+    std::swap(loaded, previous);
+    return loaded.pop();
+  }
+
+  if (SlabPool::is_realtime()) {
+    throw std::bad_alloc();
+  }
+
+  loaded = SlabPool::take(idx);
+  return loaded.pop();
+}
+
+inline auto SlabPool::deallocate(void* ptr, std::size_t size) -> void {
+  if (size > MAX_SIZE) {
+    ::operator delete(ptr, size);
+    return;
+  }
+
+  auto idx = SlabPool::index(size == 0 ? 1 : size);
+  auto& cache = SlabPool::cache();
+  auto& loaded = cache.loaded[idx];
+  auto& previous = cache.previous[idx];
+  if (loaded.size >= MAGAZINE_SIZE && !SlabPool::is_realtime()) {
+    if (previous.size != 0) {
+      SlabPool::give(idx, previous);
+      previous = loaded;
+      loaded = Magazine();
+    } else {
+      std::swap(loaded, previous);
+    }
+  }
+
+  loaded.push(static_cast<Block*>(ptr));
+}
+
+inline auto SlabPool::reserve(std::size_t size, uint count) -> void {
+  if (size == 0 || size > MAX_SIZE) {
+    return;
+  }
+
+  auto idx = SlabPool::index(size);
+  auto& cache = SlabPool::cache();
+  auto& loaded = cache.loaded[idx];
+  while (loaded.size + cache.previous[idx].size < count) {
+    auto magazine = SlabPool::take(idx);
+    while (magazine.head != nullptr) {
+      loaded.push(magazine.pop());
+    }
+  }
+}
+
+inline auto SlabPool::Magazine::push(Block* block) -> void {
+  block->next = this->head;
+  this->head = block;
+  this->size++;
+}
+
+inline auto SlabPool::Magazine::pop() -> Block* {
+  auto block = this->head;
+  this->head = block->next;
+  this->size--;
+  return block;
+}
+
+inline auto SlabPool::Magazine::split(uint count) -> Magazine {
+  Magazine front;
+  if (count == 0) {
+    return front;
+  }
+
+  auto last = this->head;
+  for (uint i = 1; i < count; i++) {
+    last = last->next;
+  }
+
+  front.head = this->head;
+  front.size = count;
+  this->head = last->next;
+  this->size -= count;
+  last->next = nullptr;
+  return front;
+}
+
+inline SlabPool::Cache::~Cache() {
+  auto& depot = SlabPool::depot();
+  std::lock_guard<std::mutex> lock(depot.mutex);
+  for (std::size_t i = 0; i < CLASS_COUNT; i++) {
+    depot.stock(i, this->loaded[i]);
+    depot.stock(i, this->previous[i]);
+  }
+}
+
+inline auto SlabPool::Depot::stock(std::size_t index, Magazine magazine) -> void {
+  while (magazine.size >= MAGAZINE_SIZE) {
+    this->full[index].push_back(magazine.split(MAGAZINE_SIZE));
+  }
+
+  auto& partial = this->partial[index];
+  while (magazine.head != nullptr) {
+    partial.push(magazine.pop());
+    if (partial.size == MAGAZINE_SIZE) {
+      this->full[index].push_back(partial);
+      partial = Magazine();
+    }
+  }
+}
+
+inline auto SlabPool::cache() -> Cache& {
+  thread_local Cache cache;
+  return cache;
+}
+
+inline auto SlabPool::depot() -> Depot& {
+  static Depot* depot = new Depot();
+  return *depot;
+}
+
+inline auto SlabPool::take(std::size_t index) -> Magazine {
+  auto& depot = SlabPool::depot();
+  {
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    if (!depot.full[index].empty()) {
+      auto magazine = depot.full[index].back();
+      depot.full[index].pop_back();
+      return magazine;
+    }
+
+    if (depot.partial[index].head != nullptr) {
+      return std::exchange(depot.partial[index], Magazine());
+    }
+  }
+
+  // NOTE: the slab itself is never freed, its blocks are always reachable
+  // through the magazines or the objects using them
+  Magazine magazine;
+  auto block_size = (index + 1) * CLASS_SIZE;
+  auto slab = static_cast<std::byte*>(::operator new(SLAB_SIZE));
+  for (std::size_t offset = 0; offset + block_size <= SLAB_SIZE; offset += block_size) {
+    magazine.push(reinterpret_cast<Block*>(slab + offset));
+  }
+
+  // NOTE: small size classes fit many magazines into a slab, a thread only
+  // keeps one of them and leaves the rest to the others
+  if (magazine.size <= MAGAZINE_SIZE) {
+    return magazine;
+  }
+
+  auto front = magazine.split(MAGAZINE_SIZE);
+  std::lock_guard<std::mutex> lock(depot.mutex);
+  depot.stock(index, magazine);
+  return front;
+}
+
+inline auto SlabPool::give(std::size_t index, Magazine magazine) -> void {
+  auto& depot = SlabPool::depot();
+  std::lock_guard<std::mutex> lock(depot.mutex);
+  depot.stock(index, magazine);
+}
+
+// an allocator using the slab pool, for use with standard containers and
+// std::allocate_shared
+template<typename T>
+struct SlabAllocator {
+  using value_type = T;
+
+  SlabAllocator() = default;
+
+  template<typename U>
+  SlabAllocator(SlabAllocator<U> const&) {}
+
+  auto allocate(std::size_t n) -> T* {
+    static_assert(alignof(T) <= SlabPool::CLASS_SIZE, "over aligned types are not supported");
+    return static_cast<T*>(SlabPool::allocate(n * sizeof(T)));
+  }
+
+  auto deallocate(T* ptr, std::size_t n) -> void {
+    SlabPool::deallocate(ptr, n * sizeof(T));
+  }
+
+  template<typename U>
+  auto operator==(SlabAllocator<U> const&) const -> bool { return true; }
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+// a pointer which stores a small tag in its unused low bits
+//
+// the pointee must be aligned to at least 4 bytes, which holds for anything
+// containing a pointer or a reference count, a null pointer may still carry a
+// tag, only the all zero state is considered null
+
+#include <cstdint>
+#include <sys/types.h>
+
+template<typename T>
+class TaggedPtr {
+  public:
+    static constexpr std::uintptr_t TAG_MASK = 0b11;
+
+  public:
+    TaggedPtr() : _bits(0) {}
+    TaggedPtr(T* ptr, uint tag) : _bits(
+      reinterpret_cast<std::uintptr_t>(ptr) | (static_cast<std::uintptr_t>(tag) & TAG_MASK)
+    ) {}
+
+  public:
+    auto ptr() const -> T* { return reinterpret_cast<T*>(this->_bits & ~TAG_MASK); }
+    auto tag() const -> uint { return static_cast<uint>(this->_bits & TAG_MASK); }
+    auto is_null() const -> bool { return this->_bits == 0; }
+
+    auto operator==(TaggedPtr<T> const& other) const -> bool = default;
+
+  private:
+    std::uintptr_t _bits;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+// thread policies of the persistent collections
+//
+// a policy decides how the nodes of a collection are reference counted and
+// where they are allocated, the shared policy uses atomic reference counts so
+// values of a collection may be sent to and shared between threads, the local
+// policy uses plain integers, which avoids the atomic read modify write on
+// every node copied or dropped by a modification, but values must never leave
+// the thread they were created on
+//
+// both policies allocate nodes from the slab pool (see
+// src/utils/slab_pool.hpp), a custom policy may provide its own allocation
+// functions instead
+//
+// a policy has the following members
+//
+//   static constexpr bool IS_LOCAL = ...;
+//   using RefCount = ...;
+//   template<typename T> using SharedPtr = ...;
+//   template<typename T, typename... Args>
+//   static auto make_shared(Args&&... args) -> SharedPtr<T>;
+//   template<typename T> static auto shared_size() -> std::size_t;
+//   static auto allocate(std::size_t size) -> void*;
+//   static auto deallocate(void* ptr, std::size_t size) -> void;
+//   using Mutex = ...;
+//
+// a SharedPtr to a derived type must convert to a SharedPtr to its base and
+// provide use_count, like std::shared_ptr
+
+#include "src/utils/local_shared_ptr.hpp"
+#include "src/utils/ref_count.hpp"
+#include "src/utils/slab_pool.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace thread_policy {
+  // the default, values may be shared between threads
+  struct Shared {
+    static constexpr bool IS_LOCAL = false;
+
+    using RefCount = ::RefCount;
+
+    template<typename T>
+    using SharedPtr = std::shared_ptr<T>;
+
+    template<typename T, typename... Args>
+    static auto make_shared(Args&&... args) -> SharedPtr<T> {
+      return std::allocate_shared<T>(SlabAllocator<T>(), std::forward<Args>(args)...);
+    }
+
+    // return the size of the block make_shared allocates for a T, the layout
+    // of the control block is up to the standard library, so this is measured
+    // once by an allocator which records the size instead of allocating
+    template<typename T>
+    static auto shared_size() -> std::size_t;
+
+    static auto allocate(std::size_t size) -> void* { return SlabPool::allocate(size); }
+    static auto deallocate(void* ptr, std::size_t size) -> void { SlabPool::deallocate(ptr, size); }
+
+    using Mutex = std::mutex;
+  };
+
+  // thrown by SizeProbe instead of allocating
+  struct Probed {};
+
+  // an allocator which records the size of the first allocation and throws
+  // Probed instead of allocating, see Shared::shared_size
+  template<typename T>
+  struct SizeProbe {
+    using value_type = T;
+
+    SizeProbe(std::size_t* size) : size(size) {}
+
+    template<typename U>
+    SizeProbe(SizeProbe<U> const& other) : size(other.size) {}
+
+    auto allocate(std::size_t n) -> T* {
+      *this->size = n * sizeof(T);
+      throw Probed();
+    }
+
+    auto deallocate(T*, std::size_t) -> void {}
+
+    template<typename U>
+    auto operator==(SizeProbe<U> const&) const -> bool { return true; }
+
+    std::size_t* size;
+  };
+
+  template<typename T>
+  auto Shared::shared_size() -> std::size_t {
+    static std::size_t size = []() {
+      std::size_t size = 0;
+      try {
+        std::allocate_shared<T>(SizeProbe<T>(&size));
+      } catch (Probed const&) {}
+
+      return size;
+    }();
+
+    return size;
+  }
+
+  // a mutex for values which never leave their thread, nobody else can
+  // hold it, so locking does nothing
+  struct NoMutex {
+    auto lock() -> void {}
+    auto unlock() -> void {}
+  };
+
+  // values never leave the thread they were created on, operations which
+  // would hand them to other threads don't compile and debug builds check
+  // the thread on every reference count change
+  struct Local {
+    static constexpr bool IS_LOCAL = true;
+
+    using RefCount = ::LocalRefCount;
+
+    template<typename T>
+    using SharedPtr = LocalSharedPtr<T>;
+
+    template<typename T, typename... Args>
+    static auto make_shared(Args&&... args) -> SharedPtr<T> {
+      return LocalSharedPtr<T>::make(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    static auto shared_size() -> std::size_t { return LocalSharedPtr<T>::block_size(); }
+
+    static auto allocate(std::size_t size) -> void* { return SlabPool::allocate(size); }
+    static auto deallocate(void* ptr, std::size_t size) -> void { SlabPool::deallocate(ptr, size); }
+
+    using Mutex = NoMutex;
+  };
+}
@@ -0,0 +1,276 @@
+#pragma once
+
+// a work stealing thread pool for fork join parallelism
+//
+// every worker owns a deque of tasks, it pushes and pops its own tasks at the
+// back and steals from the front of the other deques once it runs out of work,
+// threads which don't belong to the pool share one additional deque
+//
+// join runs one function on the calling thread and offers the other one to be
+// stolen, while the calling thread waits for a stolen task it runs other tasks
+// instead of blocking, so nested joins never starve the pool
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sys/types.h>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class ThreadPool {
+  // constructors
+  public:
+    // create a pool with the given number of worker threads
+    ThreadPool(uint threads);
+
+    ThreadPool(ThreadPool const&) = delete;
+    auto operator=(ThreadPool const&) -> ThreadPool& = delete;
+
+    ~ThreadPool();
+
+  public:
+    // return the shared pool, which has one worker per hardware thread and
+    // is started on first use
+    static auto global() -> ThreadPool&;
+
+  // accessors
+  public:
+    auto size() const -> uint { return this->_workers.size(); }
+
+  // methods
+  public:
+    // run both functions, possibly in parallel, and return their results,
+    // if either throws the exception is rethrown once both have finished
+    template<typename F, typename G>
+    auto join(F const& left, G const& right) -> std::pair<
+      std::invoke_result_t<F const&>,
+      std::invoke_result_t<G const&>
+    >;
+
+  private:
+    struct Task {
+      std::function<void()> func;
+      std::exception_ptr error;
+      std::atomic<bool> done = false;
+    };
+
+    struct Queue {
+      std::mutex mutex;
+      std::deque<Task*> tasks;
+    };
+
+  private:
+    // the queue tasks of the calling thread are pushed to
+    auto local() -> Queue&;
+
+    auto push(Task* task) -> void;
+
+    // take the given task back from the local queue if it was not stolen
+    auto take(Task* task) -> bool;
+
+    // take any task, preferring the newest local one
+    auto find() -> Task*;
+
+    auto run(Task* task) -> void;
+
+    // wait for the given task, running other tasks in the meantime
+    auto wait(Task* task) -> void;
+
+    auto work(uint index) -> void;
+
+  private:
+    // one queue per worker, followed by the shared queue
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _workers;
+
+    // the number of tasks which are queued but not yet taken, workers sleep
+    // while this is zero
+    std::atomic<uint> _pending;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stop;
+
+    // the pool and queue index of the calling thread, if it is a worker
+    inline static thread_local ThreadPool* _current_pool = nullptr;
+    inline static thread_local uint _current_index = 0;
+};
+
+inline ThreadPool::ThreadPool(uint threads) : _pending(0), _stop(false) {
+  threads = std::max(threads, 1u);
+
+  for (uint i = 0; i <= threads; i++) {
+    this->_queues.emplace_back(std::make_unique<Queue>());
+  }
+
+  for (uint i = 0; i < threads; i++) {
+    this->_workers.emplace_back([this, i]() { this->work(i); });
+  }
+}
+
+inline ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_stop = true;
+  }
+
+  this->_wake.notify_all();
+  for (auto& worker : this->_workers) {
+    worker.join();
+  }
+}
+
+inline auto ThreadPool::global() -> ThreadPool& {
+  static ThreadPool pool(std::thread::hardware_concurrency());
+  return pool;
+}
+
+template<typename F, typename G>
+auto ThreadPool::join(F const& left, G const& right) -> std::pair<
+  std::invoke_result_t<F const&>,
+  std::invoke_result_t<G const&>
+> {
+  std::optional<std::invoke_result_t<G const&>> right_result;
+
+  // NOTE: the task lives on this stack frame, so we must not return before
+  // it's done, even if left throws
+  Task task;
+  task.func = [&right, &right_result]() { right_result.emplace(right()); };
+  this->push(&task);
+
+  std::optional<std::invoke_result_t<F const&>> left_result;
+  try {
+    left_result.emplace(left());
+  } catch (...) {
+    this->wait(&task);
+    throw;
+  }
+
+  this->wait(&task);
+  if (task.error) {
+    std::rethrow_exception(task.error);
+  }
+
+  return std::pair(std::move(*left_result), std::move(*right_result));
+}
+
+inline auto ThreadPool::local() -> Queue& {
+  if (ThreadPool::_current_pool == this) {
+    return *this->_queues[ThreadPool::_current_index];
+  }
+
+  return *this->_queues.back();
+}
+
+inline auto ThreadPool::push(Task* task) -> void {
+  {
+    auto& queue = this->local();
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(task);
+  }
+
+  // NOTE: taking the lock orders this with a worker checking _pending before
+  // going to sleep, otherwise the notification could be lost
+  this->_pending.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(this->_mutex);
+  }
+  this->_wake.notify_one();
+}
+
+inline auto ThreadPool::take(Task* task) -> bool {
+  auto& queue = this->local();
+  std::lock_guard<std::mutex> lock(queue.mutex);
+
+  // NOTE: the shared queue may have received tasks of other threads since,
+  // so the task is not necessarily at the back
+  auto it = std::find(queue.tasks.rbegin(), queue.tasks.rend(), task);
+  if (it == queue.tasks.rend()) {
+    return false;
+  }
+
+  queue.tasks.erase(std::next(it).base());
+  this->_pending.fetch_sub(1);
+  return true;
+}
+
+inline auto ThreadPool::find() -> Task* {
+  uint start = ThreadPool::_current_pool == this
+    ? ThreadPool::_current_index
+    : this->_queues.size() - 1;
+
+  {
+    auto& queue = *this->_queues[start];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      Task* task = queue.tasks.back();
+      queue.tasks.pop_back();
+      this->_pending.fetch_sub(1);
+      return task;
+    }
+  }
+
+  for (uint i = 1; i < this->_queues.size(); i++) {
+    auto& queue = *this->_queues[(start + i) % this->_queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      Task* task = queue.tasks.front();
+      queue.tasks.pop_front();
+      this->_pending.fetch_sub(1);
+      return task;
+    }
+  }
+
+  return nullptr;
+}
+
+inline auto ThreadPool::run(Task* task) -> void {
+  try {
+    task->func();
+  } catch (...) {
+    task->error = std::current_exception();
+  }
+
+  task->done.store(true, std::memory_order_release);
+}
+
+inline auto ThreadPool::wait(Task* task) -> void {
+  if (this->take(task)) {
+    this->run(task);
+    return;
+  }
+
+  while (!task->done.load(std::memory_order_acquire)) {
+    if (Task* other = this->find()) {
+      this->run(other);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+inline auto ThreadPool::work(uint index) -> void {
+  ThreadPool::_current_pool = this;
+  ThreadPool::_current_index = index;
+
+  while (true) {
+    if (Task* task = this->find()) {
+      this->run(task);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    this->_wake.wait(lock, [this]() { return this->_stop || this->_pending.load() != 0; });
+    if (this->_stop) {
+      return;
+    }
+  }
+}